@@ -1,9 +1,15 @@
 #include "config.h"
+#include "../trace.h"
 
 #include <QApplication>
+#include <QDateTime>
+#include <QFileInfo>
 
 using namespace Qt::StringLiterals;
 
+// Parameters kept in a profile, the rest are shared
+static constexpr Param::Key ProfileKeys[] = {Param::Sources, Param::Token, Param::Endpoint, Param::Cnrelay};
+
 Config::Config() : QSettings(u"config.ini"_s, IniFormat)
 {
     params.emplace(Param::Port, u"port"_s, u"-p"_s, QMetaType::QString, u"11111:11112"_s);
@@ -18,15 +24,115 @@ Config::Config() : QSettings(u"config.ini"_s, IniFormat)
     params.emplace(Param::Cnrelay, u"cnrelay"_s, u"-c"_s, QMetaType::QString);
 
     beginGroup(QApplication::applicationName());
+
+    // Write the file off the GUI thread
+    writer = new SettingsWriter(fileName());
+    writerThread.setObjectName(u"settings"_s);
+    writer->moveToThread(&writerThread);
+    writerThread.start();
 }
 
 Config::~Config()
 {
     endGroup();
+    QMetaObject::invokeMethod(writer, &SettingsWriter::flush, Qt::BlockingQueuedConnection);
+    writerThread.quit();
+    writerThread.wait();
+    delete writer;
+}
+
+// QSettings would write the file from this thread on its own
+bool Config::event(QEvent *e)
+{
+    if (e->type() == QEvent::UpdateRequest)
+    {
+        return true;
+    }
+    return QSettings::event(e);
+}
+
+// Pick up the file if it was changed by someone else,
+// so that readSettings sees the new values
+bool Config::refresh()
+{
+    const qint64 modified = QFileInfo(fileName()).lastModified().toMSecsSinceEpoch();
+    if (modified == writer->savedTime())
+    {
+        return false;
+    }
+    sync();
+    return true;
+}
+
+// Store the current parameters as a profile and make it active
+void Config::saveProfile(const QString &name)
+{
+    QVariantMap values;
+    for (const Param::Key &key : ProfileKeys)
+    {
+        values.insert(params[key].name, params[key]);
+    }
+    profiles.insert(name, values);
+    profile = name;
+}
+
+bool Config::applyProfile(const QString &name)
+{
+    if (!profiles.contains(name))
+    {
+        return false;
+    }
+    const QList<Param> values = profileParams(name);
+    for (const Param::Key &key : ProfileKeys)
+    {
+        params[key].setValue(static_cast<const QVariant &>(values[key]));
+    }
+    profile = name;
+    return true;
+}
+
+// The current parameters with those of a profile
+QList<Param> Config::profileParams(const QString &name) const
+{
+    QList<Param> values = params;
+    const QVariantMap stored = profiles.value(name);
+    for (const Param::Key &key : ProfileKeys)
+    {
+        if (stored.contains(values[key].name))
+        {
+            values[key].setValue(stored[values[key].name]);
+        }
+    }
+    return values;
+}
+
+// The profile most likely to be switched to: the one used before,
+// or else the first other one
+QString Config::nextProfile() const
+{
+    if (profiles.contains(standbyProfile) && standbyProfile != profile)
+    {
+        return standbyProfile;
+    }
+    for (auto it = profiles.cbegin(); it != profiles.cend(); it++)
+    {
+        if (it.key() != profile)
+        {
+            return it.key();
+        }
+    }
+    return QString();
+}
+
+// The ports the server listens on
+QString Config::ports() const
+{
+    return activePorts.isEmpty() ? params[Param::Port].value<QString>() : activePorts;
 }
 
 void Config::readSettings()
 {
+    const TraceSpan span("Config::readSettings", "startup");
     for (Param &param : params)
     {
         QVariant v = value(param.name);
@@ -40,12 +146,85 @@ void Config::readSettings()
     startup = value("startup").value<bool>();
     startMinimized = value("startMinimized").value<bool>();
     checkUpdate = value("checkUpdate").value<bool>();
+    windowRelease = value("windowRelease", 10).value<int>();
+    control = value("control", true).value<bool>();
+    systemLog = value("systemLog", 0).value<int>();
     theme = value("theme").value<QString>();
     debugInfo = value("debugInfo").value<bool>();
+    autoSources = value("autoSources").value<bool>();
+    portFallback = value("portFallback").value<bool>();
+    networkRecovery = value("networkRecovery", true).value<bool>();
+
+    pacProxy = value("pacProxy").value<bool>();
+    pacPort = value("pacPort", 11110).value<int>();
+    pacHosts = value("pacHosts").value<QStringList>();
+
+    metrics = value("metrics").value<bool>();
+    metricsPort = value("metricsPort", 11119).value<int>();
+
+    frontProxy = value("frontProxy").value<bool>();
+    cacheTtl = value("cacheTtl", 30).value<int>();
+    hedging = value("hedging").value<bool>();
+    hedgeServer = value("hedgeServer").value<QString>();
+    hedgeSources = value("hedgeSources").value<QStringList>();
+    warmStandby = value("warmStandby", true).value<bool>();
+    clientConnections = value("clientConnections").value<int>();
+    totalConnections = value("totalConnections").value<int>();
+    clientBandwidth = value("clientBandwidth").value<int>();
+    clientWeights = value("clientWeights").value<QStringList>();
+    probeInterval = value("probeInterval", 5).value<int>();
+    probeTimeout = value("probeTimeout", 2000).value<int>();
+    probeSlow = value("probeSlow", 1000).value<int>();
+    probeFailures = value("probeFailures", 3).value<int>();
+    warmUp = value("warmUp").value<bool>();
+    // A song without copyright on NetEase, so that it is matched
+    warmUpSongs = value("warmUpSongs", QStringList{u"186016"_s}).value<QStringList>();
+    monitorInterval = value("monitorInterval", 2).value<int>();
+    memoryAlert = value("memoryAlert", 0).value<int>();
+    memoryGrowthAlert = value("memoryGrowthAlert", 50).value<int>();
+    history = value("history", true).value<bool>();
+    stallThreshold = value("stallThreshold", 250).value<int>();
+    telemetry = value("telemetry", true).value<bool>();
+    recycleMemory = value("recycleMemory", 0).value<int>();
+    recycleUptime = value("recycleUptime", 0).value<int>();
+    recycleHour = value("recycleHour", -1).value<int>();
+    recycleGrace = value("recycleGrace", 10).value<int>();
+    cpuAffinity = value("cpuAffinity").value<QString>();
+    niceness = value("niceness", 0).value<int>();
+    schedPolicy = value("schedPolicy", 0).value<int>();
+    ioClass = value("ioClass", 0).value<int>();
+    ioLevel = value("ioLevel", 4).value<int>();
+    cgroup = value("cgroup").value<QString>();
+    cgroupMemory = value("cgroupMemory", 0).value<int>();
+    cgroupCpu = value("cgroupCpu", 0).value<int>();
+    dynamicScheduling = value("dynamicScheduling", true).value<bool>();
+    logRequestPattern = value("logRequestPattern", uR"(\b(?:getting|searching|matching)\b.*?\b(?<id>\d{3,})\b)"_s).value<QString>();
+    logMatchPattern = value("logMatchPattern", uR"(\b(?:replaced|matched)\b.*?\b(?<id>\d{3,})\b(?:.*?\b(?:from|source|with)\W+(?!source\b)(?<source>[a-z]+))?)"_s).value<QString>();
+    logFailPattern = value("logFailPattern", uR"(\b(?:no (?:audio|source|match)|not (?:found|matched)|unavailable)\b.*?\b(?<id>\d{3,})\b)"_s).value<QString>();
+    logErrorPattern = value("logErrorPattern", uR"(^\W*(?:error|fatal)\b)"_s).value<QString>();
 
     other = value("other").value<QStringList>();
 
     env = value("env").value<QStringList>();
+
+    profile = value("profile").value<QString>();
+    standbyProfile = value("standbyProfile").value<QString>();
+    profiles.clear();
+    beginGroup(u"profiles"_s);
+    for (const QString &name : childGroups())
+    {
+        beginGroup(name);
+        QVariantMap values;
+        for (const Param::Key &key : ProfileKeys)
+        {
+            QVariant v = value(params[key].name, params[key]);
+            v.convert(QMetaType(params[key].typeId));
+            values.insert(params[key].name, v);
+        }
+        profiles.insert(name, values);
+        endGroup();
+    }
+    endGroup();
 }
 
 void Config::writeSettings()
@@ -57,10 +236,80 @@ void Config::writeSettings()
     setValue("startup", startup);
     setValue("startMinimized", startMinimized);
     setValue("checkUpdate", checkUpdate);
+    setValue("windowRelease", windowRelease);
+    setValue("control", control);
+    setValue("systemLog", systemLog);
     setValue("theme", theme);
     setValue("debugInfo", debugInfo);
+    setValue("autoSources", autoSources);
+    setValue("portFallback", portFallback);
+    setValue("networkRecovery", networkRecovery);
+
+    setValue("pacProxy", pacProxy);
+    setValue("pacPort", pacPort);
+    setValue("pacHosts", pacHosts);
+
+    setValue("metrics", metrics);
+    setValue("metricsPort", metricsPort);
+
+    setValue("frontProxy", frontProxy);
+    setValue("cacheTtl", cacheTtl);
+    setValue("hedging", hedging);
+    setValue("hedgeServer", hedgeServer);
+    setValue("hedgeSources", hedgeSources);
+    setValue("warmStandby", warmStandby);
+    setValue("clientConnections", clientConnections);
+    setValue("totalConnections", totalConnections);
+    setValue("clientBandwidth", clientBandwidth);
+    setValue("clientWeights", clientWeights);
+    setValue("probeInterval", probeInterval);
+    setValue("probeTimeout", probeTimeout);
+    setValue("probeSlow", probeSlow);
+    setValue("probeFailures", probeFailures);
+    setValue("warmUp", warmUp);
+    setValue("warmUpSongs", warmUpSongs);
+    setValue("monitorInterval", monitorInterval);
+    setValue("memoryAlert", memoryAlert);
+    setValue("memoryGrowthAlert", memoryGrowthAlert);
+    setValue("history", history);
+    setValue("stallThreshold", stallThreshold);
+    setValue("telemetry", telemetry);
+    setValue("recycleMemory", recycleMemory);
+    setValue("recycleUptime", recycleUptime);
+    setValue("recycleHour", recycleHour);
+    setValue("recycleGrace", recycleGrace);
+    setValue("cpuAffinity", cpuAffinity);
+    setValue("niceness", niceness);
+    setValue("schedPolicy", schedPolicy);
+    setValue("ioClass", ioClass);
+    setValue("ioLevel", ioLevel);
+    setValue("cgroup", cgroup);
+    setValue("cgroupMemory", cgroupMemory);
+    setValue("cgroupCpu", cgroupCpu);
+    setValue("dynamicScheduling", dynamicScheduling);
+    setValue("logRequestPattern", logRequestPattern);
+    setValue("logMatchPattern", logMatchPattern);
+    setValue("logFailPattern", logFailPattern);
+    setValue("logErrorPattern", logErrorPattern);
 
     setValue("other", other);
 
     setValue("env", env);
+
+    setValue("profile", profile);
+    setValue("standbyProfile", standbyProfile);
+    remove(u"profiles"_s);
+    beginGroup(u"profiles"_s);
+    for (auto it = profiles.cbegin(); it != profiles.cend(); it++)
+    {
+        beginGroup(it.key());
+        for (auto entry = it->cbegin(); entry != it->cend(); entry++)
+        {
+            setValue(entry.key(), entry.value());
+        }
+        endGroup();
+    }
+    endGroup();
+
+    QMetaObject::invokeMethod(writer, &SettingsWriter::save);
 }
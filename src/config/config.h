@@ -1,8 +1,11 @@
 #pragma once
 
 #include "param.h"
+#include "settingswriter.h"
 
+#include <QMap>
 #include <QSettings>
+#include <QThread>
 
 class Config : QSettings
 {
@@ -10,18 +13,94 @@ public:
     Config();
     ~Config();
 
+    using QSettings::fileName;
+
     QList<Param> params;
 
     bool startup;
     bool startMinimized;
     bool checkUpdate;
+    int windowRelease;
+    bool control;
+    int systemLog;
     QString theme;
     bool debugInfo;
+    bool autoSources;
+    bool portFallback;
+    bool networkRecovery;
+
+    bool pacProxy;
+    int pacPort;
+    QStringList pacHosts;
+
+    bool metrics;
+    int metricsPort;
+
+    bool frontProxy;
+    int cacheTtl;
+    bool hedging;
+    QString hedgeServer;
+    QStringList hedgeSources;
+    bool warmStandby;
+    int clientConnections;
+    int totalConnections;
+    int clientBandwidth;
+    QStringList clientWeights;
+    int probeInterval;
+    int probeTimeout;
+    int probeSlow;
+    int probeFailures;
+    bool warmUp;
+    QStringList warmUpSongs;
+    int monitorInterval;
+    int memoryAlert;
+    int memoryGrowthAlert;
+    bool history;
+    int stallThreshold;
+    bool telemetry;
+    int recycleMemory;
+    int recycleUptime;
+    int recycleHour;
+    int recycleGrace;
+    QString cpuAffinity;
+    int niceness;
+    int schedPolicy;
+    int ioClass;
+    int ioLevel;
+    QString cgroup;
+    int cgroupMemory;
+    int cgroupCpu;
+    bool dynamicScheduling;
+    QString logRequestPattern;
+    QString logMatchPattern;
+    QString logFailPattern;
+    QString logErrorPattern;
 
     QStringList other;
 
     QStringList env;
 
+    // Named sets of source and account parameters
+    QMap<QString, QVariantMap> profiles;
+    QString profile;
+    QString standbyProfile;
+
+    // Ports the server moved to when the configured ones were taken, never saved
+    QString activePorts;
+
     void readSettings();
     void writeSettings();
+    bool refresh();
+    void saveProfile(const QString &name);
+    bool applyProfile(const QString &name);
+    QList<Param> profileParams(const QString &name) const;
+    QString nextProfile() const;
+    QString ports() const;
+
+protected:
+    bool event(QEvent *e) override;
+
+private:
+    QThread writerThread;
+    SettingsWriter *writer;
 };
@@ -0,0 +1,44 @@
+#include "settingswriter.h"
+
+#include <QDateTime>
+#include <QFileInfo>
+
+// Time to wait for more changes before writing
+static constexpr int SaveDelay = 500;
+
+SettingsWriter::SettingsWriter(const QString &fileName)
+    : QObject(), settings(new QSettings(fileName, QSettings::IniFormat, this)),
+      timer(new QTimer(this)), saved(0)
+{
+    timer->setSingleShot(true);
+    connect(timer, &QTimer::timeout, this, &SettingsWriter::flush);
+}
+
+SettingsWriter::~SettingsWriter()
+{
+}
+
+qint64 SettingsWriter::savedTime() const
+{
+    return saved.load(std::memory_order_acquire);
+}
+
+void SettingsWriter::save()
+{
+    timer->start(SaveDelay);
+}
+
+// Settings objects of the same file share their changes, so syncing
+// this one writes what the GUI thread has set
+void SettingsWriter::flush()
+{
+    timer->stop();
+    settings->sync();
+    if (settings->status() != QSettings::NoError)
+    {
+        qWarning() << "Unable to write" << settings->fileName();
+        return;
+    }
+    saved.store(QFileInfo(settings->fileName()).lastModified().toMSecsSinceEpoch(),
+                std::memory_order_release);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <QSettings>
+#include <QTimer>
+
+#include <atomic>
+
+// Writes the settings file from its own thread. Saves requested in quick
+// succession are coalesced, and QSettings replaces the file atomically.
+class SettingsWriter : public QObject
+{
+    Q_OBJECT
+
+public:
+    SettingsWriter(const QString &fileName);
+    ~SettingsWriter();
+
+    // Modification time of the file as last written here
+    qint64 savedTime() const;
+
+public slots:
+    void save();
+    void flush();
+
+private:
+    QSettings *settings;
+    QTimer *timer;
+    std::atomic<qint64> saved;
+};
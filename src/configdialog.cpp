@@ -6,6 +6,7 @@
 #include <QDesktopServices>
 #include <QLocale>
 #include <QMessageBox>
+#include <QRegularExpression>
 
 using namespace Qt::StringLiterals;
 
@@ -19,12 +20,73 @@ ConfigDialog::ConfigDialog(Config *config, QWidget *parent)
     ui->startupCheckBox->setChecked(config->startup);
     ui->minimizeCheckBox->setChecked(config->startMinimized);
     ui->updateCheckBox->setChecked(config->checkUpdate);
+    ui->windowReleaseSpinBox->setValue(config->windowRelease);
+    ui->controlCheckBox->setChecked(config->control);
+    ui->systemLogComboBox->setCurrentIndex(config->systemLog);
+    ui->pacGroupBox->setChecked(config->pacProxy);
+    ui->pacPortSpinBox->setValue(config->pacPort);
+    ui->pacHostsEdit->setText(config->pacHosts.join(u", "_s));
+    ui->metricsGroupBox->setChecked(config->metrics);
+    ui->metricsPortSpinBox->setValue(config->metricsPort);
 
     ui->tokenEdit->setText(config->params[Param::Token].value<QString>());
     ui->endpointEdit->setText(config->params[Param::Endpoint].value<QString>());
     ui->cnrelayEdit->setText(config->params[Param::Cnrelay].value<QString>());
     ui->otherEdit->setPlainText(config->other.join("\n"));
     ui->envEdit->setPlainText(config->env.join("\n"));
+    ui->portFallbackCheckBox->setChecked(config->portFallback);
+    ui->networkRecoveryCheckBox->setChecked(config->networkRecovery);
+    ui->frontGroupBox->setChecked(config->frontProxy);
+    ui->cacheTtlSpinBox->setValue(config->cacheTtl);
+    ui->hedgeCheckBox->setChecked(config->hedging);
+    ui->hedgeServerEdit->setText(config->hedgeServer);
+    ui->hedgeSourcesEdit->setText(config->hedgeSources.join(u", "_s));
+    ui->warmStandbyCheckBox->setChecked(config->warmStandby);
+    ui->clientConnectionsSpinBox->setValue(config->clientConnections);
+    ui->totalConnectionsSpinBox->setValue(config->totalConnections);
+    ui->clientBandwidthSpinBox->setValue(config->clientBandwidth);
+    ui->clientWeightsEdit->setText(config->clientWeights.join(u", "_s));
+    ui->probeIntervalSpinBox->setValue(config->probeInterval);
+    ui->probeSlowSpinBox->setValue(config->probeSlow);
+    ui->probeFailuresSpinBox->setValue(config->probeFailures);
+    ui->warmUpCheckBox->setChecked(config->warmUp);
+    ui->warmUpSongsEdit->setText(config->warmUpSongs.join(u", "_s));
+    ui->monitorIntervalSpinBox->setValue(config->monitorInterval);
+    ui->memoryAlertSpinBox->setValue(config->memoryAlert);
+    ui->memoryGrowthAlertSpinBox->setValue(config->memoryGrowthAlert);
+    ui->historyCheckBox->setChecked(config->history);
+    ui->stallThresholdSpinBox->setValue(config->stallThreshold);
+    ui->telemetryCheckBox->setChecked(config->telemetry);
+    ui->recycleMemorySpinBox->setValue(config->recycleMemory);
+    ui->recycleUptimeSpinBox->setValue(config->recycleUptime);
+    ui->recycleHourSpinBox->setValue(config->recycleHour);
+    ui->recycleGraceSpinBox->setValue(config->recycleGrace);
+    ui->cpuAffinityEdit->setText(config->cpuAffinity);
+    ui->nicenessSpinBox->setValue(config->niceness);
+    ui->schedPolicyComboBox->setCurrentIndex(config->schedPolicy);
+    ui->ioClassComboBox->setCurrentIndex(config->ioClass);
+    ui->ioLevelSpinBox->setValue(config->ioLevel);
+    ui->cgroupEdit->setText(config->cgroup);
+    ui->cgroupMemorySpinBox->setValue(config->cgroupMemory);
+    ui->cgroupCpuSpinBox->setValue(config->cgroupCpu);
+    ui->dynamicSchedulingCheckBox->setChecked(config->dynamicScheduling);
+    ui->logRequestPatternEdit->setText(config->logRequestPattern);
+    ui->logMatchPatternEdit->setText(config->logMatchPattern);
+    ui->logFailPatternEdit->setText(config->logFailPattern);
+    ui->logErrorPatternEdit->setText(config->logErrorPattern);
+#ifndef Q_OS_LINUX
+    // I/O priority and cgroups only exist on Linux
+    const QList<QWidget *> linuxOnly = {ui->ioClassComboBox, ui->ioLevelSpinBox, ui->cgroupEdit,
+                                        ui->cgroupMemorySpinBox, ui->cgroupCpuSpinBox};
+    for (QWidget *widget : linuxOnly)
+    {
+        ui->schedulingLayout->setRowVisible(widget, false);
+    }
+    // The telemetry pipe is inherited as a file descriptor
+    ui->monitorLayout->setRowVisible(ui->telemetryCheckBox, false);
+    ui->systemLogLabel->hide();
+    ui->systemLogComboBox->hide();
+#endif
 
     connect(ui->updateButton, &QPushButton::clicked, updateChecker, &UpdateChecker::checkUpdate);
     connect(updateChecker, &UpdateChecker::ready, this, &ConfigDialog::showUpdateMessage);
@@ -65,15 +127,65 @@ void ConfigDialog::showUpdateMessage(const bool &isNewVersion, const QString &ve
 
 void ConfigDialog::accept()
 {
+    static const QRegularExpression sep(u"\\W+"_s);
+
     config->startup = ui->startupCheckBox->isChecked();
     config->startMinimized = ui->minimizeCheckBox->isChecked();
     config->checkUpdate = ui->updateCheckBox->isChecked();
+    config->windowRelease = ui->windowReleaseSpinBox->value();
+    config->control = ui->controlCheckBox->isChecked();
+    config->systemLog = ui->systemLogComboBox->currentIndex();
+    config->pacProxy = ui->pacGroupBox->isChecked();
+    config->pacPort = ui->pacPortSpinBox->value();
+    config->pacHosts = ui->pacHostsEdit->text().remove(u' ').split(u',', Qt::SkipEmptyParts);
+    config->metrics = ui->metricsGroupBox->isChecked();
+    config->metricsPort = ui->metricsPortSpinBox->value();
 
     config->params[Param::Token].setValue(ui->tokenEdit->text());
     config->params[Param::Endpoint].setValue(ui->endpointEdit->text());
     config->params[Param::Cnrelay].setValue(ui->cnrelayEdit->text());
     config->other = ui->otherEdit->toPlainText().split(u'\n', Qt::SkipEmptyParts);
     config->env = ui->envEdit->toPlainText().split(u'\n', Qt::SkipEmptyParts);
+    config->portFallback = ui->portFallbackCheckBox->isChecked();
+    config->networkRecovery = ui->networkRecoveryCheckBox->isChecked();
+    config->frontProxy = ui->frontGroupBox->isChecked();
+    config->cacheTtl = ui->cacheTtlSpinBox->value();
+    config->hedging = ui->hedgeCheckBox->isChecked();
+    config->hedgeServer = ui->hedgeServerEdit->text();
+    config->hedgeSources = ui->hedgeSourcesEdit->text().split(sep, Qt::SkipEmptyParts);
+    config->warmStandby = ui->warmStandbyCheckBox->isChecked();
+    config->clientConnections = ui->clientConnectionsSpinBox->value();
+    config->totalConnections = ui->totalConnectionsSpinBox->value();
+    config->clientBandwidth = ui->clientBandwidthSpinBox->value();
+    config->clientWeights = ui->clientWeightsEdit->text().remove(u' ').split(u',', Qt::SkipEmptyParts);
+    config->probeInterval = ui->probeIntervalSpinBox->value();
+    config->probeSlow = ui->probeSlowSpinBox->value();
+    config->probeFailures = ui->probeFailuresSpinBox->value();
+    config->warmUp = ui->warmUpCheckBox->isChecked();
+    config->warmUpSongs = ui->warmUpSongsEdit->text().split(sep, Qt::SkipEmptyParts);
+    config->monitorInterval = ui->monitorIntervalSpinBox->value();
+    config->memoryAlert = ui->memoryAlertSpinBox->value();
+    config->memoryGrowthAlert = ui->memoryGrowthAlertSpinBox->value();
+    config->history = ui->historyCheckBox->isChecked();
+    config->stallThreshold = ui->stallThresholdSpinBox->value();
+    config->telemetry = ui->telemetryCheckBox->isChecked();
+    config->recycleMemory = ui->recycleMemorySpinBox->value();
+    config->recycleUptime = ui->recycleUptimeSpinBox->value();
+    config->recycleHour = ui->recycleHourSpinBox->value();
+    config->recycleGrace = ui->recycleGraceSpinBox->value();
+    config->cpuAffinity = ui->cpuAffinityEdit->text().remove(u' ');
+    config->niceness = ui->nicenessSpinBox->value();
+    config->schedPolicy = ui->schedPolicyComboBox->currentIndex();
+    config->ioClass = ui->ioClassComboBox->currentIndex();
+    config->ioLevel = ui->ioLevelSpinBox->value();
+    config->cgroup = ui->cgroupEdit->text();
+    config->cgroupMemory = ui->cgroupMemorySpinBox->value();
+    config->cgroupCpu = ui->cgroupCpuSpinBox->value();
+    config->dynamicScheduling = ui->dynamicSchedulingCheckBox->isChecked();
+    config->logRequestPattern = ui->logRequestPatternEdit->text();
+    config->logMatchPattern = ui->logMatchPatternEdit->text();
+    config->logFailPattern = ui->logFailPatternEdit->text();
+    config->logErrorPattern = ui->logErrorPatternEdit->text();
     QDialog::accept();
 }
 
@@ -83,6 +195,8 @@ void ConfigDialog::help()
     switch (ui->tabWidget->currentIndex())
     {
     case 0:
+    case 3:
+    case 4:
         url.setUrl(QLocale::system().language() == QLocale::Language::Chinese
                        ? u"https://github.com/FrzMtrsprt/QtUnblockNeteaseMusic/blob/main/README.md"_s
                        : u"https://github.com/FrzMtrsprt/QtUnblockNeteaseMusic/blob/main/README_en.md"_s);
@@ -0,0 +1,187 @@
+#include "controlclient.h"
+#include "controlserver.h"
+#include "version.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+
+#include <cstdio>
+
+#ifdef Q_OS_WIN
+#include <Windows.h>
+#endif
+
+using namespace Qt::StringLiterals;
+
+// Time to wait for the running instance
+static constexpr int ConnectTimeout = 2000;
+
+ControlClient::ControlClient(QObject *parent)
+    : QObject(parent), socket(new QLocalSocket(this)),
+      pending(0), inputDone(false), streaming(false), exitCode(0)
+{
+    output.open(stdout, QIODevice::WriteOnly);
+    connect(socket, &QLocalSocket::readyRead, this, &ControlClient::on_readyRead);
+    connect(socket, &QLocalSocket::disconnected, this, [this]
+            { QCoreApplication::exit(pending ? 2 : exitCode); });
+}
+
+ControlClient::~ControlClient()
+{
+}
+
+bool ControlClient::isRequested(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (!qstrcmp(argv[i], "--control") || !qstrcmp(argv[i], "-control"))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+int ControlClient::run(int argc, char *argv[])
+{
+#ifdef Q_OS_WIN
+    // The GUI executable starts without a console
+    if (AttachConsole(ATTACH_PARENT_PROCESS))
+    {
+        freopen("CONOUT$", "w", stdout);
+        freopen("CONOUT$", "w", stderr);
+    }
+#endif
+
+    QCoreApplication a(argc, argv);
+    a.setApplicationName(PROJECT_NAME);
+    a.setApplicationVersion(PROJECT_VERSION);
+
+    QCommandLineParser parser;
+    parser.setSingleDashWordOptionMode(QCommandLineParser::ParseAsLongOptions);
+    parser.addHelpOption();
+    const QCommandLineOption controlOption(u"control"_s,
+                                           u"Send a command to the running instance: status, metrics, start, stop, "
+                                           "restart, get, set, proxy, profile, subscribe or unsubscribe. "
+                                           "With -, send JSON request lines from stdin."_s,
+                                           u"command"_s);
+    parser.addOption(controlOption);
+    parser.addPositionalArgument(u"args"_s,
+                                 u"Command arguments as key=value, values are JSON or plain text. "
+                                 "A bare key means key=true."_s,
+                                 u"[key=value...]"_s);
+    parser.process(a);
+
+    ControlClient client;
+    if (!client.connectToServer())
+    {
+        std::fputs("No running instance with the control API enabled.\n", stderr);
+        return 2;
+    }
+
+    const QString command = parser.value(controlOption);
+    if (command == u"-"_s)
+    {
+        // Reading stdin blocks, so it runs beside the event loop
+        QThread *inputThread = QThread::create(
+            [&client]
+            {
+                QFile input;
+                input.open(stdin, QIODevice::ReadOnly);
+                QByteArray line;
+                while (!(line = input.readLine()).isEmpty())
+                {
+                    QMetaObject::invokeMethod(&client, [&client, line]
+                                              { client.send(line.trimmed()); });
+                }
+                QMetaObject::invokeMethod(&client, &ControlClient::finishInput);
+            });
+        QObject::connect(inputThread, &QThread::finished, inputThread, &QObject::deleteLater);
+        inputThread->start();
+    }
+    else
+    {
+        QJsonObject args;
+        for (const QString &argument : parser.positionalArguments())
+        {
+            const qsizetype split = argument.indexOf(u'=');
+            if (split < 0)
+            {
+                args.insert(argument, true);
+                continue;
+            }
+            const QString value = argument.sliced(split + 1);
+            const QJsonDocument json = QJsonDocument::fromJson(("[" + value + "]").toUtf8());
+            args.insert(argument.first(split),
+                        json.isArray() ? json.array().first() : QJsonValue(value));
+        }
+        const QJsonObject request{{u"v"_s, ControlServer::Version},
+                                  {u"id"_s, 1},
+                                  {u"cmd"_s, command},
+                                  {u"args"_s, args}};
+        client.send(QJsonDocument(request).toJson(QJsonDocument::Compact));
+        client.finishInput();
+    }
+    return a.exec();
+}
+
+bool ControlClient::connectToServer()
+{
+    socket->connectToServer(ControlServer::serverName());
+    return socket->waitForConnected(ConnectTimeout);
+}
+
+void ControlClient::send(const QByteArray &line)
+{
+    if (line.isEmpty())
+    {
+        return;
+    }
+    // Subscriptions keep streaming after the replies
+    if (QJsonDocument::fromJson(line).object().value(u"cmd"_s).toString() == u"subscribe"_s)
+    {
+        streaming = true;
+    }
+    pending++;
+    socket->write(line + '\n');
+}
+
+void ControlClient::finishInput()
+{
+    inputDone = true;
+    checkDone();
+}
+
+void ControlClient::on_readyRead()
+{
+    while (socket->canReadLine())
+    {
+        const QByteArray line = socket->readLine();
+        output.write(line);
+        const QJsonObject message = QJsonDocument::fromJson(line).object();
+        if (message.contains(u"event"_s))
+        {
+            continue;
+        }
+        pending--;
+        if (!message.value(u"ok"_s).toBool())
+        {
+            exitCode = 1;
+        }
+    }
+    output.flush();
+    checkDone();
+}
+
+void ControlClient::checkDone()
+{
+    if (inputDone && pending <= 0 && !streaming)
+    {
+        socket->disconnectFromServer();
+        QCoreApplication::exit(exitCode);
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <QFile>
+#include <QLocalSocket>
+
+// Command line mode talking to the running instance's control server:
+//   --control status
+//   --control set port=8080 strict=false
+//   --control subscribe log tail=50 metrics=1000
+//   --control - reads request lines from stdin, for many requests in a row
+class ControlClient : public QObject
+{
+    Q_OBJECT
+
+public:
+    ControlClient(QObject *parent = nullptr);
+    ~ControlClient();
+
+    static bool isRequested(int argc, char *argv[]);
+    static int run(int argc, char *argv[]);
+
+private:
+    QLocalSocket *socket;
+    QFile output;
+    qint64 pending;
+    bool inputDone;
+    bool streaming;
+    int exitCode;
+
+    bool connectToServer();
+    void send(const QByteArray &line);
+    void finishInput();
+    void on_readyRead();
+    void checkDone();
+};
@@ -0,0 +1,349 @@
+#include "controlserver.h"
+#include "metrics.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QRegularExpression>
+#include <QTimer>
+
+using namespace Qt::StringLiterals;
+
+// Longest request line accepted
+static constexpr qint64 MaxLine = 1024 * 1024;
+// Unsent bytes after which a subscriber that does not read is dropped
+static constexpr qint64 MaxBacklog = 4 * 1024 * 1024;
+// Metrics interval when subscribing with true, and the shortest allowed
+static constexpr int MetricsInterval = 1000;
+static constexpr int MinMetricsInterval = 100;
+
+ControlServer::ControlServer(Config *config, WindowHost *host, LogStore *logStore)
+    : QLocalServer(), config(config), host(host), logStore(logStore)
+{
+    connect(this, &QLocalServer::newConnection, this, &ControlServer::on_newConnection);
+    connect(logStore, &LogStore::appended, this, &ControlServer::on_logAppended);
+}
+
+ControlServer::~ControlServer()
+{
+}
+
+// Per user, so that other accounts neither reach nor block it
+QString ControlServer::serverName()
+{
+    return QCoreApplication::applicationName() + u"-control-"_s +
+           QString::number(qHash(QDir::homePath()), 16);
+}
+
+void ControlServer::start()
+{
+    if (!config->control || isListening())
+    {
+        return;
+    }
+    setSocketOptions(QLocalServer::UserAccessOption);
+    // A crashed run may have left its socket file behind
+    removeServer(serverName());
+    if (!listen(serverName()))
+    {
+        emit out(tr("Control server failed to listen on %1: %2")
+                     .arg(serverName(), errorString()));
+    }
+}
+
+void ControlServer::stop()
+{
+    close();
+    for (QLocalSocket *socket : findChildren<QLocalSocket *>())
+    {
+        socket->disconnectFromServer();
+    }
+}
+
+// Clients stay connected unless the API was turned off
+void ControlServer::reload()
+{
+    config->control ? start() : stop();
+}
+
+void ControlServer::on_newConnection()
+{
+    while (QLocalSocket *socket = nextPendingConnection())
+    {
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket]
+                { on_readyRead(socket); });
+        connect(socket, &QLocalSocket::disconnected, this, [this, socket]
+                { logClients.removeOne(socket);
+                  socket->deleteLater(); });
+    }
+}
+
+void ControlServer::on_readyRead(QLocalSocket *socket)
+{
+    while (socket->canReadLine())
+    {
+        const QByteArray line = socket->readLine().trimmed();
+        if (line.isEmpty())
+        {
+            continue;
+        }
+
+        QJsonParseError parseError;
+        const QJsonDocument document = QJsonDocument::fromJson(line, &parseError);
+        const QJsonObject request = document.object();
+        QJsonObject reply{{u"v"_s, Version}};
+        if (request.contains(u"id"_s))
+        {
+            reply.insert(u"id"_s, request.value(u"id"_s));
+        }
+
+        QString error;
+        QJsonValue result;
+        if (parseError.error != QJsonParseError::NoError)
+        {
+            error = u"Invalid JSON: "_s + parseError.errorString();
+        }
+        else if (!document.isObject())
+        {
+            error = u"Request is not an object"_s;
+        }
+        else if (request.value(u"v"_s).toInt(Version) > Version)
+        {
+            error = u"Unsupported protocol version, this server speaks %1"_s.arg(Version);
+        }
+        else
+        {
+            result = handle(socket, request.value(u"cmd"_s).toString(),
+                            request.value(u"args"_s).toObject(), error);
+        }
+
+        reply.insert(u"ok"_s, error.isEmpty());
+        error.isEmpty() ? reply.insert(u"result"_s, result)
+                        : reply.insert(u"error"_s, error);
+        send(socket, reply);
+    }
+
+    if (socket->bytesAvailable() > MaxLine)
+    {
+        send(socket, {{u"v"_s, Version}, {u"ok"_s, false}, {u"error"_s, u"Request too long"_s}});
+        socket->disconnectFromServer();
+    }
+}
+
+QJsonValue ControlServer::handle(QLocalSocket *socket, const QString &command, const QJsonObject &args, QString &error)
+{
+    if (command == u"status"_s)
+    {
+        return status();
+    }
+    if (command == u"metrics"_s)
+    {
+        return Metric::exportJson();
+    }
+    if (command == u"start"_s)
+    {
+        emit serverStart();
+        return true;
+    }
+    if (command == u"stop"_s)
+    {
+        emit serverStop();
+        return true;
+    }
+    if (command == u"restart"_s)
+    {
+        emit serverRestart();
+        return true;
+    }
+    if (command == u"get"_s)
+    {
+        return params(args.value(u"names"_s), error);
+    }
+    if (command == u"set"_s)
+    {
+        return setParams(args, error) ? params(QJsonValue(), error) : QJsonValue();
+    }
+    if (command == u"proxy"_s)
+    {
+        return setProxy(args.value(u"enable"_s), error);
+    }
+    if (command == u"profile"_s)
+    {
+        return profile(args.value(u"name"_s), error);
+    }
+    if (command == u"subscribe"_s)
+    {
+        return subscribe(socket, args);
+    }
+    if (command == u"unsubscribe"_s)
+    {
+        return subscribe(socket, QJsonObject());
+    }
+    error = u"Unknown command: %1"_s.arg(command);
+    return QJsonValue();
+}
+
+QJsonObject ControlServer::status()
+{
+    const QJsonObject metrics = Metric::exportJson();
+    return {{u"version"_s, QCoreApplication::applicationVersion()},
+            {u"protocol"_s, Version},
+            {u"pid"_s, QCoreApplication::applicationPid()},
+            {u"running"_s, Metrics::serverUptime.value() != 0},
+            {u"uptime"_s, metrics.value(u"unm_server_uptime_seconds"_s)},
+            {u"rss"_s, Metrics::serverRss.value()},
+            {u"address"_s, config->params[Param::Address].value<QString>()},
+            {u"port"_s, config->ports()},
+            {u"proxy"_s, host->isProxy()},
+            {u"window"_s, host->isVisible()}};
+}
+
+// All parameters, or the ones named by a string or an array
+QJsonObject ControlServer::params(const QJsonValue &names, QString &error)
+{
+    const QStringList wanted = names.isString()
+                                   ? QStringList{names.toString()}
+                                   : names.toVariant().toStringList();
+    QJsonObject values;
+    for (const Param &param : config->params)
+    {
+        if (wanted.isEmpty() || wanted.contains(param.name))
+        {
+            values.insert(param.name, QJsonValue::fromVariant(static_cast<const QVariant &>(param)));
+        }
+    }
+    for (const QString &name : wanted)
+    {
+        if (!values.contains(name))
+        {
+            error = u"Unknown parameter: %1"_s.arg(name);
+        }
+    }
+    return values;
+}
+
+// Nothing changes unless every value is valid
+bool ControlServer::setParams(const QJsonObject &values, QString &error)
+{
+    static const QRegularExpression sep(u"\\W+"_s);
+
+    QList<QPair<qsizetype, QVariant>> changes;
+    for (auto it = values.constBegin(); it != values.constEnd(); it++)
+    {
+        qsizetype index = -1;
+        for (qsizetype i = 0; i < config->params.size(); i++)
+        {
+            if (config->params[i].name == it.key())
+            {
+                index = i;
+            }
+        }
+        if (index < 0)
+        {
+            error = u"Unknown parameter: %1"_s.arg(it.key());
+            return false;
+        }
+        const Param &param = config->params[index];
+        QVariant value = it.value().toVariant();
+        if (param.typeId == QMetaType::QStringList && value.typeId() == QMetaType::QString)
+        {
+            value = value.toString().split(sep, Qt::SkipEmptyParts);
+        }
+        if (!value.convert(QMetaType(param.typeId)))
+        {
+            error = u"Invalid value for %1"_s.arg(it.key());
+            return false;
+        }
+        changes << qMakePair(index, value);
+    }
+
+    const bool wasProxy = host->isProxy();
+    for (const auto &[index, value] : changes)
+    {
+        config->params[index].setValue(value);
+    }
+    config->writeSettings();
+    host->reload(wasProxy);
+    return true;
+}
+
+// Toggles without a value
+QJsonValue ControlServer::setProxy(const QJsonValue &enable, QString &error)
+{
+    const bool on = enable.isBool() ? enable.toBool() : !host->isProxy();
+    if (on && !config->pacProxy && config->params[Param::Strict].value<bool>())
+    {
+        error = u"Strict mode does not allow the system proxy"_s;
+        return QJsonValue();
+    }
+    if (!host->setProxy(on))
+    {
+        error = u"Failed to set system proxy"_s;
+        return QJsonValue();
+    }
+    return on;
+}
+
+// Switches to the named profile, and lists them either way
+QJsonObject ControlServer::profile(const QJsonValue &name, QString &error)
+{
+    if (name.isString() && !host->switchProfile(name.toString()))
+    {
+        error = u"Unknown profile: %1"_s.arg(name.toString());
+    }
+    return {{u"profile"_s, config->profile},
+            {u"standby"_s, config->standbyProfile},
+            {u"profiles"_s, QJsonArray::fromStringList(config->profiles.keys())}};
+}
+
+// Replaces the socket's subscriptions, tail replays stored log messages
+QJsonObject ControlServer::subscribe(QLocalSocket *socket, const QJsonObject &args)
+{
+    const bool log = args.value(u"log"_s).toBool();
+    logClients.removeOne(socket);
+    if (log)
+    {
+        const QStringList messages = logStore->messages();
+        for (const QString &message : messages.last(qBound(0, args.value(u"tail"_s).toInt(), int(messages.size()))))
+        {
+            send(socket, {{u"v"_s, Version}, {u"event"_s, u"log"_s}, {u"message"_s, message}});
+        }
+        logClients << socket;
+    }
+
+    delete socket->findChild<QTimer *>();
+    const QJsonValue metrics = args.value(u"metrics"_s);
+    const int interval = metrics.isBool()
+                             ? (metrics.toBool() ? MetricsInterval : 0)
+                             : qMax(metrics.toInt(), 0);
+    if (interval)
+    {
+        QTimer *timer = new QTimer(socket);
+        connect(timer, &QTimer::timeout, socket, [socket]
+                { send(socket, {{u"v"_s, Version}, {u"event"_s, u"metrics"_s}, {u"metrics"_s, Metric::exportJson()}}); });
+        timer->start(qMax(interval, MinMetricsInterval));
+    }
+    return {{u"log"_s, log}, {u"metrics"_s, interval ? qMax(interval, MinMetricsInterval) : 0}};
+}
+
+void ControlServer::on_logAppended(const QString &message)
+{
+    const QJsonObject event{{u"v"_s, Version}, {u"event"_s, u"log"_s}, {u"message"_s, message}};
+    // Slow clients are dropped while sending
+    const QList<QLocalSocket *> clients = logClients;
+    for (QLocalSocket *socket : clients)
+    {
+        send(socket, event);
+    }
+}
+
+void ControlServer::send(QLocalSocket *socket, const QJsonObject &message)
+{
+    if (socket->bytesToWrite() > MaxBacklog)
+    {
+        socket->abort();
+        return;
+    }
+    socket->write(QJsonDocument(message).toJson(QJsonDocument::Compact) + '\n');
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "config/config.h"
+#include "logstore.h"
+#include "windowhost.h"
+
+#include <QJsonObject>
+#include <QLocalServer>
+#include <QLocalSocket>
+
+// Versioned JSON-lines API on a local socket of the current user.
+// Each request line {"v":1,"id":1,"cmd":"status","args":{}} gets one
+// reply line with the same id; subscriptions add event lines.
+class ControlServer : public QLocalServer
+{
+    Q_OBJECT
+
+public:
+    static constexpr int Version = 1;
+
+    ControlServer(Config *config, WindowHost *host, LogStore *logStore);
+    ~ControlServer();
+
+    static QString serverName();
+
+public slots:
+    void start();
+    void stop();
+    void reload();
+
+signals:
+    void out(const QString &message);
+    void serverStart();
+    void serverStop();
+    void serverRestart();
+
+private:
+    Config *config;
+    WindowHost *host;
+    LogStore *logStore;
+    QList<QLocalSocket *> logClients;
+
+    void on_newConnection();
+    void on_readyRead(QLocalSocket *socket);
+    void on_logAppended(const QString &message);
+    QJsonValue handle(QLocalSocket *socket, const QString &command, const QJsonObject &args, QString &error);
+    QJsonObject status();
+    QJsonObject params(const QJsonValue &names, QString &error);
+    bool setParams(const QJsonObject &values, QString &error);
+    QJsonValue setProxy(const QJsonValue &enable, QString &error);
+    QJsonObject profile(const QJsonValue &name, QString &error);
+    QJsonObject subscribe(QLocalSocket *socket, const QJsonObject &args);
+    static void send(QLocalSocket *socket, const QJsonObject &message);
+};
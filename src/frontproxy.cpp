@@ -0,0 +1,867 @@
+#include "frontproxy.h"
+#include "metrics.h"
+#include "trace.h"
+
+#include <QCryptographicHash>
+#include <QTimer>
+
+using namespace Qt::StringLiterals;
+
+// Longest request head accepted before giving up
+static constexpr qsizetype MaxHeadSize = 64 * 1024;
+// Largest lookup body buffered for coalescing
+static constexpr qsizetype MaxBodySize = 1024 * 1024;
+// Time a lookup may take before its waiters get an error
+static constexpr int LookupTimeout = 30 * 1000;
+// Number of cached lookup responses
+static constexpr int CacheSize = 256;
+// Hedge delay bounds, used until enough lookups were measured
+static constexpr int MinHedgeDelay = 100;
+static constexpr int DefaultHedgeDelay = 1000;
+static constexpr qsizetype MinHedgeSamples = 20;
+// Data buffered per tunnel before the sending side is paused
+static constexpr qint64 MaxPending = 256 * 1024;
+// Retry interval of a tunnel waiting for bandwidth
+static constexpr int PumpInterval = 20;
+// Idle time before a client's statistics are dropped
+static constexpr qint64 ClientExpiry = 5 * 60 * 1000;
+
+// Requests resolving a song's player URL, which go through the whole match
+static const QList<QByteArray> LookupPaths = {
+    "/song/enhance/player/url"_ba,
+    "/song/enhance/download/url"_ba,
+    "/song/url"_ba,
+};
+
+// State of one client connection
+class ProxySession : public QObject
+{
+public:
+    ProxySession(QTcpSocket *client, QObject *parent)
+        : QObject(parent), client(client)
+    {
+        client->setParent(this);
+    }
+
+    QTcpSocket *client;
+    QTcpSocket *upstream = nullptr;
+    QString peer;
+    QByteArray buffer;
+    QElapsedTimer queueTimer;
+    bool admitted = false;
+    bool dispatched = false;
+    bool relayed = false;
+    bool upstreamDone = false;
+    bool pumpScheduled = false;
+};
+
+FrontProxy::FrontProxy(Config *config)
+    : QTcpServer(), config(config), backendPort(0), hedgePort(0),
+      standbyPort(0), pendingPort(0), onStandby(false),
+      cache(CacheSize), lookups(0), hits(0), coalesced(0),
+      hedgesFired(0), hedgeWins(0), activeTotal(0),
+      statsTimer(new QTimer(this))
+{
+    qRegisterMetaType<QList<ClientStats>>();
+
+    connect(this, &FrontProxy::newConnection,
+            this, &FrontProxy::on_newConnection);
+    connect(statsTimer, &QTimer::timeout,
+            this, &FrontProxy::updateClientStats);
+}
+
+FrontProxy::~FrontProxy()
+{
+    stop();
+}
+
+void FrontProxy::start()
+{
+    if (!config->frontProxy || isListening())
+    {
+        return;
+    }
+
+    const quint16 port = listenPort();
+    if (!port)
+    {
+        return;
+    }
+
+    if (!listen(listenAddress(), port))
+    {
+        emit out(tr("Front end failed to listen on port %1: %2")
+                     .arg(port)
+                     .arg(errorString()));
+        return;
+    }
+    statsTimer->start(1000);
+}
+
+void FrontProxy::stop()
+{
+    close();
+    statsTimer->stop();
+    clients.clear();
+    activeTotal = 0;
+    emit clientStatsChanged({});
+    // Aborting emits disconnected, which edits the set
+    for (ProxySession *session : std::exchange(sessions, {}))
+    {
+        session->client->abort();
+        session->deleteLater();
+    }
+    Metrics::proxyConnections.set(0);
+    emit connectionsChanged(0);
+    for (const Flight &flight : std::exchange(flights, {}))
+    {
+        release(flight.primary);
+        release(flight.hedge);
+    }
+    cache.clear();
+}
+
+void FrontProxy::restart()
+{
+    stop();
+    start();
+}
+
+// Keep client connections unless the listening address changes
+void FrontProxy::reload()
+{
+    if (isListening() == config->frontProxy &&
+        (!isListening() || (serverAddress() == listenAddress() && serverPort() == listenPort())))
+    {
+        return;
+    }
+    restart();
+}
+
+QHostAddress FrontProxy::listenAddress() const
+{
+    const QHostAddress address(config->params[Param::Address].value<QString>());
+    return address.isNull() ? QHostAddress(QHostAddress::Any) : address;
+}
+
+quint16 FrontProxy::listenPort() const
+{
+    return config->params[Param::Port].value<QString>().split(u':')[0].toUShort();
+}
+
+void FrontProxy::setBackend(const QString &host, const quint16 &port)
+{
+    // Keep forwarding to the standby until the restarted primary answers
+    if (onStandby)
+    {
+        pendingHost = host;
+        pendingPort = port;
+        return;
+    }
+    backendHost = host;
+    backendPort = port;
+    // Responses from the old server may not apply any more
+    cache.clear();
+}
+
+void FrontProxy::setHedgeBackend(const QString &host, const quint16 &port)
+{
+    hedgeHost = host;
+    hedgePort = port;
+}
+
+void FrontProxy::setStandbyBackend(const QString &host, const quint16 &port)
+{
+    standbyHost = host;
+    standbyPort = port;
+    // The standby went away while serving, the primary is all there is
+    if (onStandby && !port)
+    {
+        on_primaryReady();
+    }
+}
+
+// The standby runs the profile just switched to, forward there
+// right away instead of waiting for the primary to restart with it
+void FrontProxy::switchToStandby(const qint64 &requested)
+{
+    if (!standbyPort || onStandby)
+    {
+        return;
+    }
+    pendingHost = backendHost;
+    pendingPort = backendPort;
+    setBackend(standbyHost, standbyPort);
+    onStandby = true;
+
+    const qint64 elapsed = Trace::now() - requested;
+    Metrics::profileSwitch.set(elapsed / 1000);
+    emit out(tr("Switched to the standby server in %1 ms.").arg(elapsed / 1e6, 0, 'f', 2));
+}
+
+void FrontProxy::on_primaryReady()
+{
+    if (!onStandby)
+    {
+        return;
+    }
+    onStandby = false;
+    setBackend(pendingHost, pendingPort);
+}
+
+void FrontProxy::on_newConnection()
+{
+    while (QTcpSocket *client = nextPendingConnection())
+    {
+        ProxySession *session = new ProxySession(client, this);
+        sessions.insert(session);
+        Metrics::proxyConnections.set(sessions.size());
+        emit connectionsChanged(sessions.size());
+
+        // Count IPv4 clients the same on dual stack sockets
+        QHostAddress peer = client->peerAddress();
+        bool isIPv4;
+        const quint32 ipv4 = peer.toIPv4Address(&isIPv4);
+        session->peer = (isIPv4 ? QHostAddress(ipv4) : peer).toString();
+
+        connect(client, &QTcpSocket::readyRead, session, [this, session]
+                { if (session->admitted)
+                      on_clientRead(session); });
+        connect(client, &QTcpSocket::bytesWritten, session, [this, session]
+                { pump(session); });
+        connect(client, &QTcpSocket::disconnected, session, [this, session]
+                { on_clientDisconnected(session); });
+        admit(session);
+    }
+}
+
+void FrontProxy::on_clientDisconnected(ProxySession *session)
+{
+    sessions.remove(session);
+    session->deleteLater();
+    Metrics::proxyConnections.set(sessions.size());
+    emit connectionsChanged(sessions.size());
+
+    auto it = clients.find(session->peer);
+    if (it == clients.end())
+    {
+        return;
+    }
+    if (session->admitted)
+    {
+        it->active--;
+        activeTotal--;
+        it->lastActive.start();
+    }
+    else
+    {
+        it->queue.removeOne(session);
+    }
+    schedule();
+}
+
+bool FrontProxy::hasSlot(const ClientState &state) const
+{
+    return (!config->clientConnections || state.active < config->clientConnections) &&
+           (!config->totalConnections || activeTotal < config->totalConnections);
+}
+
+void FrontProxy::admit(ProxySession *session)
+{
+    auto it = clients.find(session->peer);
+    if (it == clients.end())
+    {
+        it = clients.insert(session->peer, ClientState());
+        it->weight = clientWeight(session->peer);
+        it->lastActive.start();
+    }
+
+    if (it->queue.isEmpty() && hasSlot(*it))
+    {
+        activate(session, *it);
+    }
+    else
+    {
+        session->queueTimer.start();
+        it->queue << session;
+        it->queuedTotal++;
+    }
+}
+
+void FrontProxy::activate(ProxySession *session, ClientState &state)
+{
+    session->admitted = true;
+    state.active++;
+    activeTotal++;
+    if (session->client->bytesAvailable())
+    {
+        on_clientRead(session);
+    }
+}
+
+// Weighted fair share of connection slots: a free slot goes to the
+// waiting client holding the fewest slots for its weight
+void FrontProxy::schedule()
+{
+    while (!config->totalConnections || activeTotal < config->totalConnections)
+    {
+        ClientState *next = nullptr;
+        for (ClientState &state : clients)
+        {
+            if (state.queue.isEmpty() || !hasSlot(state))
+            {
+                continue;
+            }
+            if (!next ||
+                state.active * next->weight < next->active * state.weight ||
+                (state.active * next->weight == next->active * state.weight &&
+                 state.queue.first()->queueTimer.elapsed() > next->queue.first()->queueTimer.elapsed()))
+            {
+                next = &state;
+            }
+        }
+        if (!next)
+        {
+            break;
+        }
+        ProxySession *session = next->queue.takeFirst();
+        next->waitTotal += session->queueTimer.elapsed();
+        next->waitCount++;
+        activate(session, *next);
+    }
+}
+
+int FrontProxy::clientWeight(const QString &peer) const
+{
+    for (const QString &entry : config->clientWeights)
+    {
+        const qsizetype pos = entry.indexOf(u'=');
+        if (pos > 0 && entry.first(pos).trimmed() == peer)
+        {
+            return qMax(entry.sliced(pos + 1).toInt(), 1);
+        }
+    }
+    return 1;
+}
+
+// Take up to wanted bytes from the client's token bucket
+qint64 FrontProxy::takeTokens(ClientState &state, const qint64 &wanted)
+{
+    if (!config->clientBandwidth)
+    {
+        return wanted;
+    }
+    // Allow bursts of one second
+    const double rate = config->clientBandwidth * 1024.0;
+    if (!state.refill.isValid())
+    {
+        state.refill.start();
+        state.tokens = rate;
+    }
+    state.tokens = qMin(rate, state.tokens + state.refill.restart() * rate / 1000);
+    const qint64 granted = qMin(wanted, qint64(state.tokens));
+    state.tokens -= granted;
+    return granted;
+}
+
+// Relay buffered data from the server to the client within the limits
+void FrontProxy::pump(ProxySession *session)
+{
+    QTcpSocket *upstream = session->upstream;
+    if (!upstream || session->pumpScheduled)
+    {
+        return;
+    }
+    auto it = clients.find(session->peer);
+
+    // Let a slow client drain first
+    while (upstream->bytesAvailable() && session->client->bytesToWrite() < MaxPending)
+    {
+        const qint64 available = upstream->bytesAvailable();
+        const qint64 size = it == clients.end() ? available
+                                                : takeTokens(*it, available);
+        if (!size)
+        {
+            session->pumpScheduled = true;
+            QTimer::singleShot(PumpInterval, session, [this, session]
+                               { session->pumpScheduled = false;
+                                 pump(session); });
+            return;
+        }
+        const QByteArray data = upstream->read(size);
+        session->relayed = true;
+        session->client->write(data);
+        if (it != clients.end())
+        {
+            it->bytes += data.size();
+        }
+    }
+
+    if (session->upstreamDone && !upstream->bytesAvailable())
+    {
+        session->client->disconnectFromHost();
+    }
+}
+
+void FrontProxy::updateClientStats()
+{
+    QList<ClientStats> stats;
+    for (auto it = clients.begin(); it != clients.end();)
+    {
+        if (!it->active && it->queue.isEmpty() && it->lastActive.hasExpired(ClientExpiry))
+        {
+            it = clients.erase(it);
+            continue;
+        }
+        it->rate = 0.7 * it->rate + 0.3 * (it->bytes - it->lastBytes);
+        it->lastBytes = it->bytes;
+        stats << ClientStats{it.key(), it->weight, it->active,
+                             int(it->queue.size()), it->queuedTotal,
+                             it->waitCount ? it->waitTotal / it->waitCount : 0,
+                             it->rate, it->bytes};
+        ++it;
+    }
+    emit clientStatsChanged(stats);
+}
+
+void FrontProxy::on_clientRead(ProxySession *session)
+{
+    // Already forwarding, pass the data through
+    if (session->upstream)
+    {
+        session->upstream->write(session->client->readAll());
+        return;
+    }
+    // Waiting for a lookup, nothing more is expected
+    if (session->dispatched)
+    {
+        session->client->readAll();
+        return;
+    }
+
+    session->buffer += session->client->readAll();
+
+    Request request;
+    const qsizetype headSize = parseHead(session->buffer, request);
+    if (headSize < 0 || (headSize == 0 && session->buffer.size() > MaxHeadSize))
+    {
+        session->dispatched = true;
+        reply(session->client, errorResponse("400 Bad Request"_ba));
+        return;
+    }
+    if (headSize == 0)
+    {
+        return;
+    }
+
+    // Tunnels and streamed bodies are passed through untouched
+    if (request.method == "CONNECT"_ba || request.chunked)
+    {
+        tunnel(session, std::exchange(session->buffer, {}));
+        return;
+    }
+
+    // Everything else keeps the client's connection handling, and what
+    // follows on a kept-alive connection goes the same way
+    if (!isLookup(request) || request.contentLength > MaxBodySize)
+    {
+        tunnel(session, std::exchange(session->buffer, {}));
+        return;
+    }
+
+    // Wait for the complete body
+    if (session->buffer.size() < headSize + request.contentLength)
+    {
+        return;
+    }
+    request.body = session->buffer.sliced(headSize, request.contentLength);
+    session->buffer.clear();
+    lookup(session, request);
+}
+
+void FrontProxy::tunnel(ProxySession *session, const QByteArray &data)
+{
+    session->dispatched = true;
+
+    QTcpSocket *upstream = connectBackend(session);
+    if (!upstream)
+    {
+        reply(session->client, errorResponse("502 Bad Gateway"_ba));
+        return;
+    }
+    session->upstream = upstream;
+
+    // Keep unsent data in the kernel, so that limits hold the server back
+    upstream->setReadBufferSize(MaxPending);
+
+    QTcpSocket *client = session->client;
+    connect(upstream, &QTcpSocket::connected, session, [upstream, data]
+            { upstream->write(data); });
+    connect(upstream, &QTcpSocket::readyRead, session, [this, session]
+            { pump(session); });
+    connect(upstream, &QTcpSocket::disconnected, session, [this, session]
+            { session->upstreamDone = true;
+              pump(session); });
+    connect(upstream, &QTcpSocket::errorOccurred, session, [this, session, client](QAbstractSocket::SocketError error)
+            {
+                if (error == QAbstractSocket::RemoteHostClosedError)
+                {
+                    return;
+                }
+                session->relayed
+                    ? client->disconnectFromHost()
+                    : reply(client, errorResponse("502 Bad Gateway"_ba)); });
+}
+
+void FrontProxy::lookup(ProxySession *session, const Request &request)
+{
+    session->dispatched = true;
+    lookups++;
+    Metrics::proxyLookups.add();
+
+    // Responses may differ between accounts, so the cookie is part of the key
+    const QByteArray key = QCryptographicHash::hash(
+        request.method + ' ' + request.host + request.target + '\n' +
+            request.cookie + '\n' + request.body,
+        QCryptographicHash::Sha1);
+
+    const CacheEntry *entry = cache.object(key);
+    if (entry && !entry->expiry.hasExpired())
+    {
+        hits++;
+        Metrics::proxyCacheHits.add();
+        reply(session->client, entry->response);
+        emitStats();
+        return;
+    }
+
+    auto it = flights.find(key);
+    if (it != flights.end())
+    {
+        coalesced++;
+        Metrics::proxyCoalesced.add();
+        it->waiters << session->client;
+        emitStats();
+        return;
+    }
+
+    Flight &flight = flights[key];
+    flight.request = serialize(request);
+    flight.waiters << session->client;
+    flight.timer.start();
+
+    flight.primary = sendLookup(key, backendHost, backendPort, flight.request);
+    if (!flight.primary)
+    {
+        finishFlight(key, errorResponse("502 Bad Gateway"_ba), false);
+        return;
+    }
+    if (hedgePort)
+    {
+        QTimer::singleShot(hedgeDelay(), flight.primary, [this, key]
+                           { startHedge(key); });
+    }
+    emitStats();
+}
+
+QTcpSocket *FrontProxy::sendLookup(const QByteArray &key, const QString &host, const quint16 &port, const QByteArray &data)
+{
+    if (!port)
+    {
+        return nullptr;
+    }
+    QTcpSocket *upstream = new QTcpSocket(this);
+    connect(upstream, &QTcpSocket::connected, upstream, [upstream, data]
+            { upstream->write(data); });
+    connect(upstream, &QTcpSocket::disconnected, this, [this, key, upstream]
+            { on_lookupDone(key, upstream, true); });
+    // Queued, as the caller has not stored the socket yet
+    connect(upstream, &QTcpSocket::errorOccurred, this, [this, key, upstream](QAbstractSocket::SocketError error)
+            { if (error != QAbstractSocket::RemoteHostClosedError)
+                  on_lookupDone(key, upstream, false); }, Qt::QueuedConnection);
+    QTimer::singleShot(LookupTimeout, upstream, [this, key, upstream]
+                       { on_lookupDone(key, upstream, false); });
+    upstream->connectToHost(host, port);
+    return upstream;
+}
+
+void FrontProxy::startHedge(const QByteArray &key)
+{
+    auto it = flights.find(key);
+    if (it == flights.end() || it->hedged)
+    {
+        return;
+    }
+    it->hedged = true;
+    it->hedge = sendLookup(key, hedgeHost, hedgePort, it->request);
+    if (it->hedge)
+    {
+        hedgesFired++;
+    }
+}
+
+void FrontProxy::on_lookupDone(const QByteArray &key, QTcpSocket *upstream, const bool &complete)
+{
+    auto it = flights.find(key);
+    if (it == flights.end())
+    {
+        return;
+    }
+    const bool isHedge = upstream == it->hedge;
+    if (!isHedge && upstream != it->primary)
+    {
+        return;
+    }
+
+    QByteArray &response = isHedge ? it->hedgeResponse : it->primaryResponse;
+    response += upstream->readAll();
+    release(upstream);
+    (isHedge ? it->hedge : it->primary) = nullptr;
+
+    // The primary answer is final, the hedge only wins with a usable one
+    if (complete && response.size() && (!isHedge || statusCode(response) == 200))
+    {
+        const qint64 elapsed = it->timer.elapsed();
+        if (isHedge)
+        {
+            hedgeWins++;
+        }
+        else
+        {
+            primaryLatency.add(elapsed);
+        }
+        servedLatency.add(elapsed);
+        finishFlight(key, closeConnection(response), true);
+        return;
+    }
+
+    // Fall back to the hedge at once when the primary fails
+    if (!isHedge)
+    {
+        startHedge(key);
+        it = flights.find(key);
+    }
+    if (it->primary || it->hedge)
+    {
+        return;
+    }
+    finishFlight(key, errorResponse(complete ? "502 Bad Gateway"_ba
+                                             : "504 Gateway Timeout"_ba),
+                 false);
+}
+
+void FrontProxy::finishFlight(const QByteArray &key, const QByteArray &response, const bool &complete)
+{
+    auto it = flights.find(key);
+    if (it == flights.end())
+    {
+        return;
+    }
+    Flight flight = std::move(*it);
+    flights.erase(it);
+
+    // A primary still running lost to the hedge, it took at least this long
+    if (flight.primary && complete)
+    {
+        primaryLatency.add(flight.timer.elapsed());
+    }
+
+    // Cancel the loser
+    release(flight.primary);
+    release(flight.hedge);
+
+    if (complete && config->cacheTtl > 0 && statusCode(response) == 200)
+    {
+        cache.insert(key, new CacheEntry{response, QDeadlineTimer(config->cacheTtl * 1000)});
+    }
+
+    if (config->debugInfo)
+    {
+        emit out(tr("Lookup finished in %1 ms for %2 client(s).")
+                     .arg(flight.timer.elapsed())
+                     .arg(flight.waiters.size()));
+    }
+
+    for (const QPointer<QTcpSocket> &client : std::as_const(flight.waiters))
+    {
+        if (client)
+        {
+            reply(client, response);
+        }
+    }
+
+    if (flight.hedged)
+    {
+        // Primary latencies include the lookups the hedge beat, counted up
+        // to the win, so the gap in their tails is at least what hedging saved
+        const qint64 saved = primaryLatency.percentile(0.99) - servedLatency.percentile(0.99);
+        emit hedgeStatsChanged(hedgesFired, hedgeWins, qMax(saved, qint64(0)));
+    }
+}
+
+// Hedge once the primary is slower than 95% of its recent lookups
+int FrontProxy::hedgeDelay() const
+{
+    if (primaryLatency.size() < MinHedgeSamples)
+    {
+        return DefaultHedgeDelay;
+    }
+    return qBound(MinHedgeDelay, int(primaryLatency.percentile(0.95)), LookupTimeout);
+}
+
+void FrontProxy::release(QTcpSocket *upstream)
+{
+    if (upstream)
+    {
+        upstream->disconnect();
+        upstream->abort();
+        upstream->deleteLater();
+    }
+}
+
+QTcpSocket *FrontProxy::connectBackend(QObject *parent)
+{
+    if (!backendPort)
+    {
+        return nullptr;
+    }
+    QTcpSocket *upstream = new QTcpSocket(parent);
+    upstream->connectToHost(backendHost, backendPort);
+    return upstream;
+}
+
+void FrontProxy::reply(QTcpSocket *client, const QByteArray &response)
+{
+    const ProxySession *session = static_cast<ProxySession *>(client->parent());
+    auto it = clients.find(session->peer);
+    if (it != clients.end())
+    {
+        it->bytes += response.size();
+    }
+    client->write(response);
+    client->disconnectFromHost();
+}
+
+void FrontProxy::emitStats()
+{
+    emit statsChanged(lookups, hits, coalesced);
+}
+
+// Returns the size of the request head, 0 if incomplete, or -1 if invalid
+qsizetype FrontProxy::parseHead(const QByteArray &data, Request &request)
+{
+    const qsizetype end = data.indexOf("\r\n\r\n");
+    if (end < 0)
+    {
+        return 0;
+    }
+
+    const QList<QByteArray> lines = data.first(end).split('\n');
+    const QList<QByteArray> requestLine = lines[0].trimmed().split(' ');
+    if (requestLine.size() != 3)
+    {
+        return -1;
+    }
+    request.method = requestLine[0];
+    request.target = requestLine[1];
+    request.version = requestLine[2];
+
+    for (qsizetype i = 1; i < lines.size(); i++)
+    {
+        const QByteArray line = lines[i].trimmed();
+        const qsizetype colon = line.indexOf(':');
+        if (colon <= 0)
+        {
+            return -1;
+        }
+        const QByteArray name = line.first(colon).trimmed().toLower();
+        const QByteArray value = line.sliced(colon + 1).trimmed();
+
+        // Connection handling is decided here, not by the client
+        if (name == "connection"_ba || name == "proxy-connection"_ba || name == "keep-alive"_ba)
+        {
+            continue;
+        }
+        if (name == "content-length"_ba)
+        {
+            bool ok;
+            request.contentLength = value.toLongLong(&ok);
+            if (!ok || request.contentLength < 0)
+            {
+                return -1;
+            }
+        }
+        else if (name == "transfer-encoding"_ba)
+        {
+            request.chunked = value.toLower().contains("chunked");
+        }
+        else if (name == "host"_ba)
+        {
+            request.host = value;
+        }
+        else if (name == "cookie"_ba)
+        {
+            request.cookie = value;
+        }
+        request.headers << line;
+    }
+    return end + 4;
+}
+
+// Rebuild the request so that the server closes the connection after replying
+QByteArray FrontProxy::serialize(const Request &request)
+{
+    QByteArray data = request.method + ' ' + request.target + ' ' + request.version + "\r\n";
+    for (const QByteArray &header : request.headers)
+    {
+        data += header + "\r\n";
+    }
+    data += "Connection: close\r\n\r\n";
+    data += request.body;
+    return data;
+}
+
+QByteArray FrontProxy::closeConnection(const QByteArray &response)
+{
+    const qsizetype end = response.indexOf("\r\n\r\n");
+    if (end < 0)
+    {
+        return response;
+    }
+
+    QByteArray head;
+    for (const QByteArray &line : response.first(end).split('\n'))
+    {
+        const QByteArray name = line.first(qMax(line.indexOf(':'), 0)).trimmed().toLower();
+        if (name != "connection"_ba && name != "keep-alive"_ba)
+        {
+            head += line.trimmed() + "\r\n";
+        }
+    }
+    return head + "Connection: close\r\n\r\n" + response.sliced(end + 4);
+}
+
+QByteArray FrontProxy::errorResponse(const QByteArray &status)
+{
+    return "HTTP/1.1 " + status + "\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+}
+
+int FrontProxy::statusCode(const QByteArray &response)
+{
+    const qsizetype space = response.indexOf(' ');
+    return space < 0 ? 0 : response.mid(space + 1, 3).toInt();
+}
+
+bool FrontProxy::isLookup(const Request &request)
+{
+    // Skip scheme and host of absolute targets
+    QByteArray path = request.target;
+    if (path.startsWith("http://"))
+    {
+        const qsizetype slash = path.indexOf('/', 7);
+        path = slash < 0 ? "/"_ba : path.sliced(slash);
+    }
+    return std::any_of(LookupPaths.cbegin(), LookupPaths.cend(),
+                       [&path](const QByteArray &lookupPath)
+                       { return path.contains(lookupPath); });
+}
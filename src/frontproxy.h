@@ -0,0 +1,168 @@
+#pragma once
+
+#include "config/config.h"
+#include "stats.h"
+
+#include <QCache>
+#include <QDeadlineTimer>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QPointer>
+#include <QSet>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+
+class ProxySession;
+
+struct ClientStats
+{
+    QString address;
+    int weight;
+    int active;
+    int queued;
+    quint64 queuedTotal;
+    qint64 averageWait;
+    double rate;
+    quint64 bytes;
+};
+
+// Native listener on the HTTP port, forwarding to the server behind it.
+// Identical song URL lookups are coalesced into one backend request,
+// and their responses are cached for a short time. Lookups slower than
+// usual are hedged to a second server when one is running. Clients
+// sharing the proxy are limited in connections and bandwidth, and
+// waiting connections are scheduled fairly between them.
+class FrontProxy : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+    FrontProxy(Config *config);
+    ~FrontProxy();
+
+public slots:
+    void start();
+    void stop();
+    void restart();
+    void reload();
+    void setBackend(const QString &host, const quint16 &port);
+    void setHedgeBackend(const QString &host, const quint16 &port);
+    void setStandbyBackend(const QString &host, const quint16 &port);
+    void switchToStandby(const qint64 &requested);
+    void on_primaryReady();
+
+signals:
+    void out(const QString &message);
+    void statsChanged(const quint64 &lookups, const quint64 &hits, const quint64 &coalesced);
+    void hedgeStatsChanged(const quint64 &fired, const quint64 &wins, const qint64 &savedMs);
+    void clientStatsChanged(const QList<ClientStats> &stats);
+    void connectionsChanged(const int &count);
+
+private:
+    struct Request
+    {
+        QByteArray method;
+        QByteArray target;
+        QByteArray version;
+        QByteArray host;
+        QByteArray cookie;
+        QList<QByteArray> headers;
+        qsizetype contentLength = 0;
+        bool chunked = false;
+        QByteArray body;
+    };
+
+    struct Flight
+    {
+        QByteArray request;
+        QTcpSocket *primary = nullptr;
+        QTcpSocket *hedge = nullptr;
+        QByteArray primaryResponse;
+        QByteArray hedgeResponse;
+        bool hedged = false;
+        QList<QPointer<QTcpSocket>> waiters;
+        QElapsedTimer timer;
+    };
+
+    struct ClientState
+    {
+        int weight = 1;
+        int active = 0;
+        QList<ProxySession *> queue;
+        quint64 queuedTotal = 0;
+        qint64 waitTotal = 0;
+        qint64 waitCount = 0;
+        double tokens = 0;
+        QElapsedTimer refill;
+        quint64 bytes = 0;
+        quint64 lastBytes = 0;
+        double rate = 0;
+        QElapsedTimer lastActive;
+    };
+
+    struct CacheEntry
+    {
+        QByteArray response;
+        QDeadlineTimer expiry;
+    };
+
+    Config *config;
+    QString backendHost;
+    quint16 backendPort;
+    QString hedgeHost;
+    quint16 hedgePort;
+    QString standbyHost;
+    quint16 standbyPort;
+    // Primary backend to return to while the standby serves
+    QString pendingHost;
+    quint16 pendingPort;
+    bool onStandby;
+
+    QSet<ProxySession *> sessions;
+    QHash<QString, ClientState> clients;
+    int activeTotal;
+    QTimer *statsTimer;
+    QHash<QByteArray, Flight> flights;
+    QCache<QByteArray, CacheEntry> cache;
+
+    quint64 lookups;
+    quint64 hits;
+    quint64 coalesced;
+    quint64 hedgesFired;
+    quint64 hedgeWins;
+    LatencyWindow primaryLatency;
+    LatencyWindow servedLatency;
+
+    void on_newConnection();
+    void on_clientRead(ProxySession *session);
+    void on_clientDisconnected(ProxySession *session);
+    bool hasSlot(const ClientState &state) const;
+    void admit(ProxySession *session);
+    void activate(ProxySession *session, ClientState &state);
+    void schedule();
+    int clientWeight(const QString &peer) const;
+    qint64 takeTokens(ClientState &state, const qint64 &wanted);
+    void pump(ProxySession *session);
+    void updateClientStats();
+    void tunnel(ProxySession *session, const QByteArray &data);
+    void lookup(ProxySession *session, const Request &request);
+    QTcpSocket *sendLookup(const QByteArray &key, const QString &host, const quint16 &port, const QByteArray &data);
+    void startHedge(const QByteArray &key);
+    void on_lookupDone(const QByteArray &key, QTcpSocket *upstream, const bool &complete);
+    void finishFlight(const QByteArray &key, const QByteArray &response, const bool &complete);
+    int hedgeDelay() const;
+    QTcpSocket *connectBackend(QObject *parent);
+    void reply(QTcpSocket *client, const QByteArray &response);
+    void emitStats();
+    QHostAddress listenAddress() const;
+    quint16 listenPort() const;
+
+    static void release(QTcpSocket *upstream);
+    static qsizetype parseHead(const QByteArray &data, Request &request);
+    static QByteArray serialize(const Request &request);
+    static QByteArray closeConnection(const QByteArray &response);
+    static QByteArray errorResponse(const QByteArray &status);
+    static int statusCode(const QByteArray &response);
+    static bool isLookup(const Request &request);
+};
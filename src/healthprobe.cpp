@@ -0,0 +1,118 @@
+#include "healthprobe.h"
+
+using namespace Qt::StringLiterals;
+
+// Probe interval while waiting for the server to come up
+static constexpr int BootInterval = 250;
+// Time the server may take to come up before probes count as failures
+static constexpr qint64 BootTimeout = 30 * 1000;
+
+HealthProbe::HealthProbe(Config *config, QObject *parent)
+    : QObject(parent), config(config),
+      timer(new QTimer(this)), socket(nullptr),
+      port(0), isReady(false), failures(0), window(120)
+{
+    connect(timer, &QTimer::timeout, this, &HealthProbe::probe);
+}
+
+HealthProbe::~HealthProbe()
+{
+}
+
+void HealthProbe::start(const QString &host, const quint16 &port)
+{
+    stop();
+    if (!port)
+    {
+        return;
+    }
+    this->host = host;
+    this->port = port;
+    startTimer.start();
+    timer->start(BootInterval);
+}
+
+void HealthProbe::stop()
+{
+    timer->stop();
+    if (socket)
+    {
+        socket->disconnect();
+        socket->abort();
+        socket->deleteLater();
+        socket = nullptr;
+    }
+    isReady = false;
+    failures = 0;
+}
+
+void HealthProbe::probe()
+{
+    // Previous probe still running, its timeout will report it
+    if (socket)
+    {
+        return;
+    }
+
+    QTcpSocket *probeSocket = new QTcpSocket(this);
+    socket = probeSocket;
+    probeTimer.start();
+
+    // The server answers this itself, without touching any source
+    connect(probeSocket, &QTcpSocket::connected, probeSocket, [probeSocket]
+            { probeSocket->write("GET /proxy.pac HTTP/1.1\r\n"
+                                 "Host: 127.0.0.1\r\n"
+                                 "Connection: close\r\n\r\n"); });
+    connect(probeSocket, &QTcpSocket::readyRead, this, [this, probeSocket]
+            { finish(probeSocket, probeSocket->peek(5) == "HTTP/"_ba); });
+    connect(probeSocket, &QTcpSocket::errorOccurred, this, [this, probeSocket]
+            { finish(probeSocket, false); }, Qt::QueuedConnection);
+    QTimer::singleShot(config->probeTimeout, probeSocket, [this, probeSocket]
+                       { finish(probeSocket, false); });
+    probeSocket->connectToHost(host, port);
+}
+
+void HealthProbe::finish(QTcpSocket *probeSocket, const bool &ok)
+{
+    if (probeSocket != socket)
+    {
+        return;
+    }
+    const qint64 latency = probeTimer.elapsed();
+    socket->disconnect();
+    socket->abort();
+    socket->deleteLater();
+    socket = nullptr;
+
+    if (!isReady)
+    {
+        // Still booting, failures do not count yet
+        if (!ok && !startTimer.hasExpired(BootTimeout))
+        {
+            return;
+        }
+        // Keep probing at the normal pace, if at all
+        config->probeInterval ? timer->start(config->probeInterval * 1000)
+                              : timer->stop();
+        if (ok)
+        {
+            isReady = true;
+            emit ready(startTimer.elapsed());
+        }
+    }
+
+    if (ok)
+    {
+        average.add(latency);
+        window.add(latency);
+    }
+    failures = ok && latency <= config->probeSlow ? 0 : failures + 1;
+    emit probed(ok ? latency : -1, average.value(), window.percentile(0.95));
+
+    if (config->probeFailures && failures >= config->probeFailures)
+    {
+        const int count = failures;
+        stop();
+        emit unhealthy(count);
+    }
+}
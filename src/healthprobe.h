@@ -0,0 +1,44 @@
+#pragma once
+
+#include "config/config.h"
+#include "stats.h"
+
+#include <QElapsedTimer>
+#include <QTcpSocket>
+#include <QTimer>
+
+// Periodically requests the server's PAC file on its HTTP port.
+// The first answer marks the server ready; consecutive slow or failed
+// probes afterwards mark it unhealthy.
+class HealthProbe : public QObject
+{
+    Q_OBJECT
+
+public:
+    HealthProbe(Config *config, QObject *parent);
+    ~HealthProbe();
+
+    void start(const QString &host, const quint16 &port);
+    void stop();
+
+signals:
+    void ready(const qint64 &elapsed);
+    void probed(const qint64 &latency, const double &average, const qint64 &p95);
+    void unhealthy(const int &failures);
+
+private:
+    Config *config;
+    QTimer *timer;
+    QTcpSocket *socket;
+    QElapsedTimer startTimer;
+    QElapsedTimer probeTimer;
+    QString host;
+    quint16 port;
+    bool isReady;
+    int failures;
+    Ewma average;
+    LatencyWindow window;
+
+    void probe();
+    void finish(QTcpSocket *probeSocket, const bool &ok);
+};
@@ -0,0 +1,89 @@
+#include "httpendpoint.h"
+
+#include <QTcpSocket>
+#include <QTimer>
+
+using namespace Qt::StringLiterals;
+
+// Longest request head accepted
+static constexpr qsizetype MaxHeadSize = 8 * 1024;
+// Time a client may take to send its request
+static constexpr int RequestTimeout = 5 * 1000;
+
+HttpEndpoint::HttpEndpoint()
+    : QTcpServer()
+{
+    connect(this, &HttpEndpoint::newConnection,
+            this, &HttpEndpoint::on_newConnection);
+}
+
+HttpEndpoint::~HttpEndpoint()
+{
+}
+
+void HttpEndpoint::route(const QByteArray &path, const Handler &handler)
+{
+    routes.insert(path, handler);
+}
+
+void HttpEndpoint::on_newConnection()
+{
+    while (QTcpSocket *socket = nextPendingConnection())
+    {
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]
+                { respond(socket); });
+        connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+        QTimer::singleShot(RequestTimeout, socket, &QTcpSocket::abort);
+    }
+}
+
+void HttpEndpoint::respond(QTcpSocket *socket)
+{
+    // Wait for the complete head, the body is never needed
+    const QByteArray data = socket->peek(MaxHeadSize);
+    if (!data.contains("\r\n\r\n"))
+    {
+        if (data.size() >= MaxHeadSize)
+        {
+            socket->abort();
+        }
+        return;
+    }
+    socket->disconnect(this);
+
+    const QList<QByteArray> requestLine = data.first(data.indexOf("\r\n")).split(' ');
+    const QByteArray method = requestLine.value(0);
+    QByteArray path = requestLine.value(1);
+    const qsizetype query = path.indexOf('?');
+    if (query >= 0)
+    {
+        path.truncate(query);
+    }
+
+    QByteArray status = "200 OK"_ba;
+    QByteArray contentType = "text/plain; charset=utf-8"_ba;
+    QByteArray body;
+    if (method != "GET"_ba && method != "HEAD"_ba)
+    {
+        status = "405 Method Not Allowed"_ba;
+    }
+    else if (const auto it = routes.constFind(path); it != routes.cend())
+    {
+        body = (*it)(contentType);
+    }
+    else
+    {
+        status = "404 Not Found"_ba;
+    }
+
+    socket->write("HTTP/1.1 " + status + "\r\n" +
+                  "Content-Type: " + contentType + "\r\n" +
+                  "Content-Length: " + QByteArray::number(body.size()) + "\r\n" +
+                  "Cache-Control: no-cache\r\n"
+                  "Connection: close\r\n\r\n");
+    if (method != "HEAD"_ba)
+    {
+        socket->write(body);
+    }
+    socket->disconnectFromHost();
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <QHash>
+#include <QTcpServer>
+
+#include <functional>
+
+// Tiny HTTP server answering GET requests on fixed paths
+class HttpEndpoint : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+    // Returns the body and sets its content type
+    using Handler = std::function<QByteArray(QByteArray &contentType)>;
+
+    HttpEndpoint();
+    ~HttpEndpoint();
+
+    void route(const QByteArray &path, const Handler &handler);
+
+private:
+    QHash<QByteArray, Handler> routes;
+
+    void on_newConnection();
+    void respond(QTcpSocket *socket);
+};
@@ -0,0 +1,221 @@
+#include "logmetrics.h"
+#include "metrics.h"
+
+#include <algorithm>
+
+using namespace Qt::StringLiterals;
+
+// Length of the rolling rate windows, in seconds
+static constexpr qsizetype RateWindow = 60;
+// Latency histograms cover the current and the previous generation
+static constexpr qint64 Generation = 5 * 60 * 1000;
+// Lookups without a result are forgotten after this time
+static constexpr qint64 PendingExpiry = 60 * 1000;
+static constexpr qsizetype MaxPending = 1024;
+// Longest line kept while waiting for its end
+static constexpr qsizetype MaxLine = 64 * 1024;
+
+// Empty patterns are disabled rather than matching every line
+static QRegularExpressionMatch find(const QRegularExpression &pattern, const QString &line)
+{
+    if (pattern.pattern().isEmpty() || !pattern.isValid())
+    {
+        return QRegularExpressionMatch();
+    }
+    return pattern.match(line);
+}
+
+LogMetrics::LogMetrics(Config *config)
+    : QObject(), config(config), generation(0),
+      requests(RateWindow), matches(RateWindow),
+      failures(RateWindow), errors(RateWindow), lines(RateWindow),
+      firstPending(false), warmedUp(false)
+{
+    clock.start();
+    loadPatterns();
+}
+
+LogMetrics::~LogMetrics()
+{
+}
+
+void LogMetrics::loadPatterns()
+{
+    const auto load = [this](QRegularExpression &pattern, const QString &source)
+    {
+        pattern.setPattern(source);
+        pattern.setPatternOptions(QRegularExpression::CaseInsensitiveOption);
+        if (!pattern.isValid())
+        {
+            qWarning() << "Invalid log pattern" << source << pattern.errorString();
+        }
+    };
+    load(requestPattern, config->logRequestPattern);
+    load(matchPattern, config->logMatchPattern);
+    load(failPattern, config->logFailPattern);
+    load(errorPattern, config->logErrorPattern);
+}
+
+// Warm-up lookups do not count as the first match
+void LogMetrics::on_serverReady()
+{
+    firstPending = false;
+}
+
+// The server is up, and warmed up if enabled
+void LogMetrics::on_primed(const bool &warmedUp)
+{
+    firstPending = true;
+    this->warmedUp = warmedUp;
+}
+
+void LogMetrics::feed(const QString &text)
+{
+    partial += text;
+    const qsizetype end = partial.lastIndexOf(u'\n');
+    if (end < 0)
+    {
+        if (partial.size() > MaxLine)
+        {
+            partial.clear();
+        }
+        return;
+    }
+    const QStringList lines = partial.first(end).split(u'\n', Qt::SkipEmptyParts);
+    partial = partial.sliced(end + 1);
+    for (const QString &line : lines)
+    {
+        parse(line);
+    }
+}
+
+void LogMetrics::parse(const QString &line)
+{
+    const qint64 now = clock.elapsed();
+    const qint64 second = now / 1000;
+    if (now - generation > Generation)
+    {
+        rotate();
+    }
+    lines.add(second);
+    Metrics::logLines.add();
+    Metrics::logLineRate.set(lines.sum(second) * 1000 / RateWindow);
+
+    if (find(errorPattern, line).hasMatch())
+    {
+        errors.add(second);
+        Metrics::logErrors.add();
+    }
+
+    QRegularExpressionMatch match = find(matchPattern, line);
+    if (match.hasMatch())
+    {
+        const QString id = match.captured(u"id"_s);
+        const QString source = match.captured(u"source"_s).toLower();
+        matches.add(second);
+        const auto it = pending.constFind(id);
+        if (it != pending.cend())
+        {
+            const qint64 latency = now - *it;
+            Metrics::matches.add();
+            Metrics::matchLatency.add(latency);
+            SourceState &state = sources[source.isEmpty() ? tr("unknown") : source];
+            state.current.add(latency);
+            state.matches++;
+            pending.erase(it);
+            if (firstPending)
+            {
+                firstPending = false;
+                Metrics::firstMatch.set(latency);
+                emit firstMatched(latency, warmedUp);
+            }
+            if (source.size())
+            {
+                Metrics::sourceMatches.add(source.toUtf8());
+                emit matched(source, latency);
+            }
+        }
+        return;
+    }
+
+    match = find(failPattern, line);
+    if (match.hasMatch())
+    {
+        failures.add(second);
+        Metrics::lookupFailures.add();
+        if (pending.remove(match.captured(u"id"_s)))
+        {
+            emit lookupFailed();
+        }
+        return;
+    }
+
+    match = find(requestPattern, line);
+    if (match.hasMatch())
+    {
+        const QString id = match.captured(u"id"_s);
+        // Several lines may mention a lookup before its result
+        if (!pending.contains(id))
+        {
+            requests.add(second);
+            Metrics::lookups.add();
+            if (pending.size() >= MaxPending)
+            {
+                pending.removeIf([now](const std::pair<const QString &, qint64 &> &entry)
+                                 { return now - entry.second > PendingExpiry; });
+            }
+            if (pending.size() < MaxPending)
+            {
+                pending.insert(id, now);
+            }
+        }
+    }
+}
+
+void LogMetrics::rotate()
+{
+    generation = clock.elapsed();
+    for (auto it = sources.begin(); it != sources.end();)
+    {
+        it->previous = it->current;
+        it->current.clear();
+        // Sources not seen for two generations are dropped
+        if (!it->previous.count())
+        {
+            it = sources.erase(it);
+            continue;
+        }
+        ++it;
+    }
+    const qint64 now = generation;
+    pending.removeIf([now](const std::pair<const QString &, qint64 &> &entry)
+                     { return now - entry.second > PendingExpiry; });
+}
+
+LogSnapshot LogMetrics::snapshot()
+{
+    const qint64 second = clock.elapsed() / 1000;
+    LogSnapshot snapshot;
+    const quint64 requestCount = requests.sum(second);
+    const quint64 matchCount = matches.sum(second);
+    const quint64 results = matchCount + failures.sum(second);
+    snapshot.requestRate = double(requestCount) / RateWindow;
+    snapshot.successRate = results ? double(matchCount) / results : 0;
+    snapshot.errorRate = double(errors.sum(second)) / RateWindow;
+    snapshot.requests = requests.values(second);
+
+    for (auto it = sources.cbegin(); it != sources.cend(); ++it)
+    {
+        Histogram latency = it->previous;
+        latency.merge(it->current);
+        snapshot.sources << SourceMetrics{it.key(), it->matches,
+                                          latency.percentile(0.5),
+                                          latency.percentile(0.9),
+                                          latency.percentile(0.99),
+                                          latency.percentile(1)};
+    }
+    std::sort(snapshot.sources.begin(), snapshot.sources.end(),
+              [](const SourceMetrics &a, const SourceMetrics &b)
+              { return a.p50 < b.p50; });
+    return snapshot;
+}
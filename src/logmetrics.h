@@ -0,0 +1,83 @@
+#pragma once
+
+#include "config/config.h"
+#include "stats.h"
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QRegularExpression>
+
+struct SourceMetrics
+{
+    QString source;
+    quint64 matches;
+    qint64 p50;
+    qint64 p90;
+    qint64 p99;
+    qint64 max;
+};
+
+struct LogSnapshot
+{
+    double requestRate;
+    double successRate;
+    double errorRate;
+    QList<double> requests;
+    QList<SourceMetrics> sources;
+};
+
+// Live metrics derived from the server log as it arrives.
+// Lookups are followed by song id from the first log line mentioning
+// them to their match or failure; all windows have fixed memory.
+class LogMetrics : public QObject
+{
+    Q_OBJECT
+
+public:
+    LogMetrics(Config *config);
+    ~LogMetrics();
+
+    void loadPatterns();
+    LogSnapshot snapshot();
+
+public slots:
+    void feed(const QString &text);
+    void on_serverReady();
+    void on_primed(const bool &warmedUp);
+
+signals:
+    void lookupFailed();
+    void matched(const QString &source, const qint64 &latency);
+    void firstMatched(const qint64 &latency, const bool &warmedUp);
+
+private:
+    struct SourceState
+    {
+        Histogram current;
+        Histogram previous;
+        quint64 matches = 0;
+    };
+
+    Config *config;
+    QElapsedTimer clock;
+    QString partial;
+    QRegularExpression requestPattern;
+    QRegularExpression matchPattern;
+    QRegularExpression failPattern;
+    QRegularExpression errorPattern;
+
+    QHash<QString, qint64> pending;
+    QHash<QString, SourceState> sources;
+    qint64 generation;
+    RollingCounter requests;
+    RollingCounter matches;
+    RollingCounter failures;
+    RollingCounter errors;
+    RollingCounter lines;
+    // The next match is the first one for a client since the server started
+    bool firstPending;
+    bool warmedUp;
+
+    void parse(const QString &line);
+    void rotate();
+};
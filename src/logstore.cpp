@@ -0,0 +1,35 @@
+#include "logstore.h"
+
+// Older messages are dropped beyond this
+static constexpr qsizetype MaxMessages = 5000;
+
+LogStore::LogStore(QObject *parent)
+    : QObject(parent)
+{
+}
+
+LogStore::~LogStore()
+{
+}
+
+QStringList LogStore::messages() const
+{
+    return store;
+}
+
+void LogStore::append(const QString &message)
+{
+    appendOutput(message);
+    emit appEvent(message);
+}
+
+// Output of the servers
+void LogStore::appendOutput(const QString &text)
+{
+    store << text;
+    if (store.size() > MaxMessages)
+    {
+        store.removeFirst();
+    }
+    emit appended(text);
+}
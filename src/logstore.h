@@ -0,0 +1,28 @@
+#pragma once
+
+#include <QObject>
+#include <QStringList>
+
+// Messages for the log view, kept while the window is not built
+class LogStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    LogStore(QObject *parent = nullptr);
+    ~LogStore();
+
+    QStringList messages() const;
+
+public slots:
+    // Messages of the app itself, also reported as events
+    void append(const QString &message);
+    void appendOutput(const QString &text);
+
+signals:
+    void appended(const QString &message);
+    void appEvent(const QString &message);
+
+private:
+    QStringList store;
+};
@@ -1,5 +1,6 @@
 #include <QCommandLineParser>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QLibraryInfo>
 #include <QMessageBox>
 #include <QThread>
@@ -11,15 +12,32 @@
 #include <Windows.h>
 #endif
 
-#include "mainwindow.h"
+#include "controlclient.h"
+#include "controlserver.h"
+#include "frontproxy.h"
+#include "metrics.h"
+#include "metricsserver.h"
+#include "networkwatcher.h"
+#include "pacserver.h"
+#include "stalldetector.h"
+#include "systemlog.h"
+#include "timeseries.h"
+#include "trace.h"
 #include "tray.h"
 #include "updatechecker.h"
 #include "version.h"
+#include "windowhost.h"
 
 using namespace Qt::StringLiterals;
 
 int main(int argc, char *argv[])
 {
+    // Scripts drive the running instance without starting another one
+    if (ControlClient::isRequested(argc, argv))
+    {
+        return ControlClient::run(argc, argv);
+    }
+
     SingleApplication a(argc, argv, true);
     a.setApplicationName(PROJECT_NAME);
     a.setApplicationVersion(PROJECT_VERSION);
@@ -30,7 +48,15 @@ int main(int argc, char *argv[])
     parser.setSingleDashWordOptionMode(QCommandLineParser::ParseAsLongOptions);
     const QCommandLineOption silentOption(u"silent"_s);
     parser.addOption(silentOption);
+    const QCommandLineOption traceOption(u"trace"_s,
+                                         u"Write a Chrome trace of startup and server lifecycle to trace.json on exit."_s);
+    parser.addOption(traceOption);
     parser.process(a);
+    if (parser.isSet(traceOption))
+    {
+        Trace::enable();
+    }
+    const qint64 startupTime = Trace::now();
 
     if (a.isSecondary())
     {
@@ -44,76 +70,274 @@ int main(int argc, char *argv[])
     }
 
     QDir::setCurrent(QApplication::applicationDirPath());
+    QElapsedTimer launchTimer;
+    launchTimer.start();
 
-    const QLocale locale = QLocale();
-    const QString translationsPath =
-        QLibraryInfo::path(QLibraryInfo::TranslationsPath);
+    // Startup runs as a small dependency graph: translations load while
+    // the objects are wired up, the server boots while the GUI is built
 
-    // load app translations
+    // Load translations in the background, they are needed by the widgets
     QTranslator appTranslator;
-    // look up e.g. :/i18n/QtUnblockNeteaseMusic_en.qm
-    if (appTranslator.load(locale, u"QtUnblockNeteaseMusic"_s, u"_"_s, u":/i18n"_s))
-    {
-        a.installTranslator(&appTranslator);
-    }
-
-    // load Qt base translations
     QTranslator baseTranslator;
-    // look up e.g. {current_path}/translations/qt_en.qm
-    if (baseTranslator.load(locale, u"qt"_s, u"_"_s, translationsPath) ||
-        baseTranslator.load(locale, u"qt"_s, u"_"_s, u"translations"_s))
-    {
-        a.installTranslator(&baseTranslator);
-    }
+    bool hasAppTranslation = false;
+    bool hasBaseTranslation = false;
+    QThread *translationThread = QThread::create(
+        [&]
+        {
+            const TraceSpan span("load translations", "startup");
+            const QLocale locale = QLocale();
+            const QString translationsPath =
+                QLibraryInfo::path(QLibraryInfo::TranslationsPath);
+            // look up e.g. :/i18n/QtUnblockNeteaseMusic_en.qm
+            hasAppTranslation = appTranslator.load(locale, u"QtUnblockNeteaseMusic"_s, u"_"_s, u":/i18n"_s);
+            // look up e.g. {current_path}/translations/qt_en.qm
+            hasBaseTranslation = baseTranslator.load(locale, u"qt"_s, u"_"_s, translationsPath) ||
+                                 baseTranslator.load(locale, u"qt"_s, u"_"_s, u"translations"_s);
+        });
+    translationThread->setObjectName(u"translations"_s);
+    translationThread->start();
 
     Config config;
+    config.readSettings();
 
-    MainWindow w(&config);
+    LogMetrics logMetrics(&config);
+    SourceRanking sourceRanking(&config);
+    QObject::connect(&logMetrics, &LogMetrics::lookupFailed, &sourceRanking, &SourceRanking::on_failed);
+    QObject::connect(&logMetrics, &LogMetrics::matched, &sourceRanking, &SourceRanking::on_matched);
 
-    Tray tray(&w);
+    // The log and status outlive the window, which is only built when shown
+    LogStore logStore;
+    WindowHost host(&config, &logMetrics, &sourceRanking, &logStore);
+
+    // The tray does not exist yet when the server starts. Its signals are
+    // queued to this thread and only delivered once the event loop runs,
+    // so they can be forwarded to the tray built meanwhile.
+    Tray *trayIcon = nullptr;
 
     Server server(&config);
-    QObject::connect(&server, &Server::out, &w, &MainWindow::on_serverOut);
-    QObject::connect(&server, &Server::err, &w, &MainWindow::on_serverErr);
-    QObject::connect(&w, &MainWindow::serverClose, &server, &Server::close);
-    QObject::connect(&w, &MainWindow::serverRestart, &server, &Server::restart);
+    QObject::connect(&server, &Server::out, &logStore, &LogStore::append);
+    QObject::connect(&server, &Server::output, &logStore, [&logStore](const QString &text, const bool &isError)
+                     { if (!isError)
+                           logStore.appendOutput(text); });
+    QObject::connect(&server, &Server::err, &host, &WindowHost::on_serverErr);
+    QObject::connect(&server, &Server::output, &logMetrics, &LogMetrics::feed);
+    QObject::connect(&server, &Server::ready, &logMetrics, &LogMetrics::on_serverReady);
+    QObject::connect(&server, &Server::primed, &logMetrics, &LogMetrics::on_primed);
+    QObject::connect(&logMetrics, &LogMetrics::firstMatched, &host, &WindowHost::on_firstMatched);
+    QObject::connect(&server, &Server::probed, &host, &WindowHost::on_probed);
+    QObject::connect(&server, &Server::portsChanged, &host, &WindowHost::on_portsChanged);
+    QObject::connect(&server, &Server::sampled, &host, &WindowHost::on_sampled);
+    QObject::connect(&server, &Server::nodeSampled, &host, &WindowHost::on_nodeSampled);
+    QObject::connect(&server, &Server::sampled, &a, [&trayIcon](const ResourceSample &sample, const ResourceSample &peak)
+                     { trayIcon->on_sampled(sample, peak); });
+    QObject::connect(&server, &Server::alert, &logStore, &LogStore::append);
+    QObject::connect(&server, &Server::alert, &a, [&trayIcon](const QString &message)
+                     { trayIcon->on_alert(message); });
+    QObject::connect(&sourceRanking, &SourceRanking::orderChanged, &server, &Server::setSourceOrder);
+    server.setSourceOrder(sourceRanking.order());
+
+    // Hedge server only runs when enabled, and its errors are not fatal
+    Server hedgeServer(&config, Server::Hedge);
+    const auto hedgeOut = [&logStore](const QString &message)
+    { logStore.append(u"[hedge] "_s + message); };
+    QObject::connect(&hedgeServer, &Server::out, &a, hedgeOut);
+    QObject::connect(&hedgeServer, &Server::alert, &a, hedgeOut);
+    QObject::connect(&hedgeServer, &Server::output, &logStore, [&logStore](const QString &text)
+                     { logStore.appendOutput(u"[hedge] "_s + text); });
+
+    // Standby server keeps the next likely profile running
+    Server standbyServer(&config, Server::Standby);
+    const auto standbyOut = [&logStore](const QString &message)
+    { logStore.append(u"[standby] "_s + message); };
+    QObject::connect(&standbyServer, &Server::out, &a, standbyOut);
+    QObject::connect(&standbyServer, &Server::alert, &a, standbyOut);
+    QObject::connect(&standbyServer, &Server::output, &logStore, [&logStore](const QString &text)
+                     { logStore.appendOutput(u"[standby] "_s + text); });
+    QObject::connect(&server, &Server::ready, &host, &WindowHost::on_serverReady);
+    QObject::connect(&host, &WindowHost::standbyChanged, &standbyServer, &Server::reload);
+
+    // Connected to the servers now, started once the tray exists
+    FrontProxy frontProxy(&config);
+    QObject::connect(&server, &Server::backendChanged, &frontProxy, &FrontProxy::setBackend);
+    QObject::connect(&hedgeServer, &Server::backendChanged, &frontProxy, &FrontProxy::setHedgeBackend);
+    QObject::connect(&standbyServer, &Server::backendChanged, &frontProxy, &FrontProxy::setStandbyBackend);
+    QObject::connect(&server, &Server::ready, &frontProxy, &FrontProxy::on_primaryReady);
+    QObject::connect(&host, &WindowHost::standbySwitch, &frontProxy, &FrontProxy::switchToStandby);
+    QObject::connect(&frontProxy, &FrontProxy::connectionsChanged, &server, &Server::setConnections);
+    QObject::connect(&frontProxy, &FrontProxy::connectionsChanged, &hedgeServer, &Server::setConnections);
+
+    // Record long-term history next to the server
+    TimeSeries timeSeries(&config);
+
+    // Report how long this launch took to become usable
+    qint64 trayElapsed = 0;
+    QObject::connect(
+        &server, &Server::ready, &a, [&logStore, &launchTimer, &trayElapsed]
+        { const qint64 readyElapsed = launchTimer.elapsed();
+          Metrics::startupReady.set(readyElapsed);
+          logStore.append(QObject::tr("Launch took %1 ms to the tray icon and %2 ms to a ready server.")
+                                   .arg(trayElapsed)
+                                   .arg(readyElapsed)); },
+        Qt::SingleShotConnection);
+
+    // Installed before the threads start, whose first messages are translated
+    translationThread->wait();
+    delete translationThread;
+    if (hasAppTranslation)
+    {
+        a.installTranslator(&appTranslator);
+    }
+    if (hasBaseTranslation)
+    {
+        a.installTranslator(&baseTranslator);
+    }
+
+    // Copy the log to the system log from its own thread, so that a slow
+    // journal never holds up the server threads
+    SystemLog systemLog(&config);
+    QThread systemLogThread;
+    systemLogThread.setObjectName(u"systemlog"_s);
+    systemLog.moveToThread(&systemLogThread);
+    const auto logOutput = [&systemLog](const QString &source)
+    {
+        return [&systemLog, source](const QString &text, const bool &isError, const qint64 &pid, const int &generation)
+        { systemLog.on_output(source, text, isError, pid, generation); };
+    };
+    QObject::connect(&server, &Server::output, &systemLog, logOutput(u"server"_s));
+    QObject::connect(&hedgeServer, &Server::output, &systemLog, logOutput(u"hedge"_s));
+    QObject::connect(&standbyServer, &Server::output, &systemLog, logOutput(u"standby"_s));
+    QObject::connect(&logStore, &LogStore::appEvent, &systemLog, &SystemLog::on_event);
+    QObject::connect(&systemLog, &SystemLog::out, &logStore, &LogStore::append);
+    QObject::connect(&host, &WindowHost::settingsChanged, &systemLog, &SystemLog::reload);
+    QObject::connect(&systemLogThread, &QThread::started, &systemLog, &SystemLog::start);
+    systemLogThread.start();
 
     // Start server in another thread
     QThread serverThread;
+    serverThread.setObjectName(u"server"_s);
     server.moveToThread(&serverThread);
+    hedgeServer.moveToThread(&serverThread);
+    standbyServer.moveToThread(&serverThread);
+    timeSeries.moveToThread(&serverThread);
     QObject::connect(&serverThread, &QThread::started, &server, &Server::start);
+    QObject::connect(&serverThread, &QThread::started, &hedgeServer, &Server::start);
+    QObject::connect(&serverThread, &QThread::started, &standbyServer, &Server::start);
+    QObject::connect(&serverThread, &QThread::started, &timeSeries, &TimeSeries::start);
     QObject::connect(&a, &QApplication::aboutToQuit, [&serverThread]
                      { serverThread.quit(); 
                        serverThread.wait(); });
+    // After the servers, to send their last words
+    QObject::connect(&a, &QApplication::aboutToQuit, [&systemLog, &systemLogThread]
+                     { QMetaObject::invokeMethod(&systemLog, &SystemLog::stop, Qt::BlockingQueuedConnection);
+                       systemLogThread.quit();
+                       systemLogThread.wait(); });
     serverThread.start();
 
+    const qint64 trayTime = Trace::now();
+    Tray tray(&host, &config);
+    trayIcon = &tray;
+    Trace::complete("Tray", "startup", trayTime, Trace::now());
+
+    QObject::connect(&host, &WindowHost::serverClose, &server, &Server::close);
+    QObject::connect(&host, &WindowHost::settingsChanged, &server, &Server::reload);
+    QObject::connect(&host, &WindowHost::serverProfile, &server, &Server::profile);
+    QObject::connect(&host, &WindowHost::serverClose, &hedgeServer, &Server::close);
+    QObject::connect(&host, &WindowHost::settingsChanged, &hedgeServer, &Server::reload);
+    QObject::connect(&host, &WindowHost::serverClose, &standbyServer, &Server::close);
+    QObject::connect(&host, &WindowHost::settingsChanged, &standbyServer, &Server::reload);
+    QObject::connect(&host, &WindowHost::settingsChanged, &timeSeries, &TimeSeries::restart);
+
+    QObject::connect(&frontProxy, &FrontProxy::out, &logStore, &LogStore::append);
+    QObject::connect(&frontProxy, &FrontProxy::statsChanged, &host, &WindowHost::on_proxyStats);
+    QObject::connect(&frontProxy, &FrontProxy::hedgeStatsChanged, &host, &WindowHost::on_hedgeStats);
+    QObject::connect(&frontProxy, &FrontProxy::clientStatsChanged, &host, &WindowHost::on_clientStats);
+    QObject::connect(&host, &WindowHost::serverClose, &frontProxy, &FrontProxy::stop);
+    QObject::connect(&host, &WindowHost::settingsChanged, &frontProxy, &FrontProxy::reload);
+
+    // Forward client connections in another thread
+    QThread proxyThread;
+    proxyThread.setObjectName(u"proxy"_s);
+    frontProxy.moveToThread(&proxyThread);
+    QObject::connect(&proxyThread, &QThread::started, &frontProxy, &FrontProxy::start);
+    QObject::connect(&a, &QApplication::aboutToQuit, [&proxyThread]
+                     { proxyThread.quit();
+                       proxyThread.wait(); });
+    proxyThread.start();
+
+    // Watch the GUI event loop from its own thread
+    StallDetector stallDetector(&config);
+    QThread watchdogThread;
+    watchdogThread.setObjectName(u"watchdog"_s);
+    stallDetector.moveToThread(&watchdogThread);
+    QObject::connect(&stallDetector, &StallDetector::stalled, &host, &WindowHost::on_stalled);
+    QObject::connect(&host, &WindowHost::settingsChanged, &stallDetector, &StallDetector::restart);
+    QObject::connect(&watchdogThread, &QThread::started, &stallDetector, &StallDetector::start);
+    QObject::connect(&a, &QApplication::aboutToQuit, [&watchdogThread]
+                     { watchdogThread.quit();
+                       watchdogThread.wait(); });
+    watchdogThread.start();
+
+    PacServer pacServer(&config);
+    QObject::connect(&pacServer, &PacServer::out, &logStore, &LogStore::append);
+    QObject::connect(&host, &WindowHost::settingsChanged, &pacServer, &PacServer::restart);
+    pacServer.start();
+
+    MetricsServer metricsServer(&config);
+    QObject::connect(&metricsServer, &MetricsServer::out, &logStore, &LogStore::append);
+    QObject::connect(&host, &WindowHost::settingsChanged, &metricsServer, &MetricsServer::restart);
+    metricsServer.start();
+
+    ControlServer controlServer(&config, &host, &logStore);
+    QObject::connect(&controlServer, &ControlServer::out, &logStore, &LogStore::append);
+    QObject::connect(&controlServer, &ControlServer::serverStart, &server, &Server::start);
+    QObject::connect(&controlServer, &ControlServer::serverStart, &hedgeServer, &Server::start);
+    QObject::connect(&controlServer, &ControlServer::serverStart, &standbyServer, &Server::start);
+    QObject::connect(&controlServer, &ControlServer::serverStop, &server, &Server::close);
+    QObject::connect(&controlServer, &ControlServer::serverStop, &hedgeServer, &Server::close);
+    QObject::connect(&controlServer, &ControlServer::serverStop, &standbyServer, &Server::close);
+    QObject::connect(&controlServer, &ControlServer::serverRestart, &server, &Server::restart);
+    QObject::connect(&controlServer, &ControlServer::serverRestart, &hedgeServer, &Server::restart);
+    QObject::connect(&controlServer, &ControlServer::serverRestart, &standbyServer, &Server::restart);
+    QObject::connect(&host, &WindowHost::settingsChanged, &controlServer, &ControlServer::reload);
+    controlServer.start();
+
+    NetworkWatcher networkWatcher(&config);
+    QObject::connect(&networkWatcher, &NetworkWatcher::changed, &server, &Server::recover);
+    QObject::connect(&networkWatcher, &NetworkWatcher::changed, &hedgeServer, &Server::recover);
+    QObject::connect(&networkWatcher, &NetworkWatcher::changed, &standbyServer, &Server::recover);
+    QObject::connect(&host, &WindowHost::settingsChanged, &networkWatcher, &NetworkWatcher::reload);
+    networkWatcher.start();
+
     UpdateChecker updateChecker;
-    QObject::connect(&updateChecker, &UpdateChecker::ready, &w, &MainWindow::gotUpdateStatus);
+    QObject::connect(&updateChecker, &UpdateChecker::ready, &host, &WindowHost::gotUpdateStatus);
     QTimer::singleShot(1000, &updateChecker, &UpdateChecker::checkUpdate);
 
     // Open when second instance started
-    QObject::connect(&a, &SingleApplication::receivedMessage, &w, [&w]
-                     {
-#ifdef Q_OS_WIN
-                         ShowWindow((HWND)w.winId(), SW_RESTORE);
-#endif
-                         w.show();
-                         w.activateWindow(); });
+    QObject::connect(&a, &SingleApplication::receivedMessage, &host, &WindowHost::show);
 
     // Disable proxy before quit or shutdown
-    QObject::connect(&a, &QApplication::aboutToQuit, &w, [&w]
-                     { if (w.isProxy()) w.setProxy(false); });
+    QObject::connect(&a, &QApplication::aboutToQuit, &host, [&host]
+                     { if (host.isProxy()) host.setProxy(false); });
 
     // Don't quit when closing dialog
     a.setQuitOnLastWindowClosed(false);
 
     tray.setVisible(true);
+    trayElapsed = launchTimer.elapsed();
+    Metrics::startupTray.set(trayElapsed);
 
-    // don't show window if "--silent" in arguments
+    // don't build the window if "--silent" in arguments
     if (!parser.isSet(silentOption) && !config.startMinimized)
     {
-        w.show();
+        host.show();
     }
 
-    return a.exec();
+    // First turn of the event loop ends startup
+    QTimer::singleShot(0, &a, [startupTime]
+                       { Trace::complete("startup", "startup", startupTime, Trace::now()); });
+
+    const int exitCode = a.exec();
+    // Server threads are joined by now, their buffers are complete
+    Trace::write(u"trace.json"_s);
+    return exitCode;
 }
@@ -1,12 +1,16 @@
 #include "mainwindow.h"
 #include "./ui_mainwindow.h"
 #include "configdialog.h"
+#include "timeseries.h"
+#include "trace.h"
 #include "version.h"
+#include "windowhost.h"
 #include "wizardpages.h"
 
 #include <QCloseEvent>
 #include <QDesktopServices>
 #include <QFontDatabase>
+#include <QInputDialog>
 #include <QMessageBox>
 #include <QRegularExpression>
 #include <QStyle>
@@ -19,11 +23,20 @@
 
 using namespace Qt::StringLiterals;
 
-MainWindow::MainWindow(Config *config)
+MainWindow::MainWindow(Config *config, LogMetrics *logMetrics, SourceRanking *sourceRanking,
+                       LogStore *logStore, WindowHost *host)
     : QMainWindow(), ui(new Ui::MainWindow),
-      config(config), statusLabel(new QLabel)
+      config(config), logMetrics(logMetrics), sourceRanking(sourceRanking),
+      host(host), dashboardTimer(new QTimer(this)), statusLabel(new QLabel),
+      cacheLabel(new QLabel), hedgeLabel(new QLabel),
+      probeLabel(new QLabel), probeSpark(new Sparkline(60))
 {
+    const TraceSpan span("MainWindow::MainWindow", "startup");
     ui->setupUi(this);
+    ui->statusBar->addPermanentWidget(cacheLabel);
+    ui->statusBar->addPermanentWidget(hedgeLabel);
+    ui->statusBar->addPermanentWidget(probeSpark);
+    ui->statusBar->addPermanentWidget(probeLabel);
 #ifdef Q_OS_WIN
     QFont font = QFont(u"Consolas"_s);
     font.setStyleHint(QFont::TypeWriter);
@@ -31,16 +44,47 @@ MainWindow::MainWindow(Config *config)
     QFont font = QFontDatabase::systemFont(QFontDatabase::FixedFont);
 #endif
     ui->outText->setFont(font);
+#ifndef Q_OS_LINUX
+    // Node.js telemetry is only collected on Linux
+    const QList<QWidget *> telemetryWidgets = {ui->loopLagLabel, ui->loopLagSpark, ui->loopLagValueLabel,
+                                               ui->gcLabel, ui->gcSpark, ui->gcValueLabel,
+                                               ui->heapLabel, ui->heapSpark, ui->heapValueLabel};
+    for (QWidget *widget : telemetryWidgets)
+    {
+        widget->hide();
+    }
+#endif
+
+    // Show what was logged before the window was built
+    ui->outText->setPlainText(logStore->messages().join(u'\n'));
+    connect(logStore, &LogStore::appended, this, &MainWindow::on_serverOut);
 
     // connect MainWindow signals
     connect(ui->actionInstallCA, &QAction::triggered, this, &MainWindow::on_installCA);
     connect(ui->actionEnv, &QAction::triggered, this, &MainWindow::on_env);
-    connect(ui->actionExit, &QAction::triggered, this, &MainWindow::exit);
+    connect(ui->actionProfileCpu, &QAction::triggered, this, [this]
+            { on_profile(Server::CpuProfile); });
+    connect(ui->actionProfileHeap, &QAction::triggered, this, [this]
+            { on_profile(Server::HeapProfile); });
+    connect(ui->actionSaveProfile, &QAction::triggered, this, &MainWindow::on_saveProfile);
+    connect(ui->actionDeleteProfile, &QAction::triggered, this, [this]
+            { this->host->deleteProfile(this->config->profile); });
+    connect(ui->menuProfiles, &QMenu::aboutToShow, this, &MainWindow::updateProfileMenu);
+    connect(ui->actionExit, &QAction::triggered, host, &WindowHost::exit);
     connect(ui->actionAbout, &QAction::triggered, this, &MainWindow::on_about);
     connect(ui->actionAboutQt, &QAction::triggered, this, &MainWindow::on_aboutQt);
-    connect(ui->proxyCheckBox, &QCheckBox::clicked, this, &MainWindow::setProxy);
+    connect(ui->proxyCheckBox, &QCheckBox::clicked, host, &WindowHost::setProxy);
+    connect(host, &WindowHost::proxyChanged, ui->proxyCheckBox, &QCheckBox::setChecked);
     connect(ui->applyBtn, &QPushButton::clicked, this, &MainWindow::on_apply);
-    connect(ui->exitBtn, &QPushButton::clicked, this, &MainWindow::exit);
+    connect(ui->exitBtn, &QPushButton::clicked, host, &WindowHost::exit);
+
+    // Only compute the dashboard while it is shown
+    connect(dashboardTimer, &QTimer::timeout, this, &MainWindow::updateDashboard);
+    connect(ui->outTabs, &QTabWidget::currentChanged, this, &MainWindow::updateDashboard);
+    connect(dashboardTimer, &QTimer::timeout, this, &MainWindow::updateHistory);
+    connect(ui->outTabs, &QTabWidget::currentChanged, this, &MainWindow::updateHistory);
+    connect(ui->historyRangeComboBox, &QComboBox::currentIndexChanged, this, &MainWindow::updateHistory);
+    dashboardTimer->start(1000);
 
     // Don't allow system proxy with strict mode
     connect(ui->strictCheckBox, &QCheckBox::checkStateChanged, this, &MainWindow::on_strictChanged);
@@ -55,7 +99,6 @@ MainWindow::MainWindow(Config *config)
     }
 
     loadSettings();
-    applySettings();
 }
 
 MainWindow::~MainWindow()
@@ -79,45 +122,6 @@ void MainWindow::setTheme(const QString &theme)
     }
 }
 
-bool MainWindow::setProxy(const bool &enable)
-{
-    const QString address = config->params[Param::Address].value<QString>();
-    const QString port = config->params[Param::Port].value<QString>().split(u':')[0];
-    bool ok = false;
-#ifdef Q_OS_WIN
-    ok = WinUtils::setSystemProxy(enable, address + u':' + port);
-#endif
-    if (!ok)
-    {
-        ui->proxyCheckBox->setChecked(isProxy());
-
-        const QString title = tr("Error");
-        const QString text =
-            tr("Failed to set system proxy.\n"
-               "Please check the server port "
-               "and address, and try again.");
-
-        QMessageBox *errorDlg = new QMessageBox(this);
-        errorDlg->setAttribute(Qt::WA_DeleteOnClose);
-        errorDlg->setWindowTitle(title);
-        errorDlg->setText(text);
-        errorDlg->setIcon(QMessageBox::Warning);
-        errorDlg->open();
-    }
-    return ok;
-}
-
-bool MainWindow::isProxy()
-{
-    const QString address = config->params[Param::Address].value<QString>();
-    const QString port = config->params[Param::Port].value<QString>().split(u':')[0];
-    bool isProxy = false;
-#ifdef Q_OS_WIN
-    isProxy = WinUtils::isSystemProxy(address + u':' + port);
-#endif
-    return isProxy;
-}
-
 void MainWindow::gotUpdateStatus(const bool &isNewVersion, const QString &version, const QString &openUrl)
 {
     if (isNewVersion)
@@ -136,40 +140,183 @@ void MainWindow::gotUpdateStatus(const bool &isNewVersion, const QString &versio
     }
 }
 
-void MainWindow::exit()
+void MainWindow::on_serverOut(const QString &message)
 {
-    qDebug("---Shutting down---");
-    emit serverClose();
-    updateSettings();
-    QApplication::exit();
+    ui->outText->appendPlainText(message);
 }
 
-void MainWindow::on_serverOut(const QString &message)
+void MainWindow::on_proxyStats(const quint64 &lookups, const quint64 &hits, const quint64 &coalesced)
 {
-    // Copy message so that it can still be accessed
-    QTimer::singleShot(0, this, [this, message]
-                       { ui->outText->appendPlainText(message); });
+    cacheLabel->setText(tr("Lookups: %1, cached: %2, coalesced: %3")
+                            .arg(lookups)
+                            .arg(hits)
+                            .arg(coalesced));
 }
 
-void MainWindow::on_serverErr(const QString &message)
+void MainWindow::on_hedgeStats(const quint64 &fired, const quint64 &wins, const qint64 &savedMs)
 {
-    const QString title = tr("Server error");
-    const QString text =
-        tr("The UnblockNeteaseMusic server "
-           "ran into an error.\n"
-           "Please change the arguments or "
-           "check port usage and try again.");
-
-    QMessageBox *errorDlg = new QMessageBox();
-    errorDlg->setAttribute(Qt::WA_DeleteOnClose);
-    errorDlg->setWindowTitle(title);
-    errorDlg->setText(text);
-    errorDlg->setDetailedText(message);
-    errorDlg->setIcon(QMessageBox::Warning);
-#ifdef Q_OS_WIN
-    WinUtils::setWindowFrame(errorDlg->winId(), errorDlg->style());
-#endif
-    errorDlg->exec();
+    hedgeLabel->setText(tr("Hedged: %1, won: %2, p99 saved: %3 ms")
+                            .arg(fired)
+                            .arg(wins)
+                            .arg(savedMs));
+}
+
+void MainWindow::on_clientStats(const QList<ClientStats> &stats)
+{
+    ui->clientTree->clear();
+    for (const ClientStats &client : stats)
+    {
+        QTreeWidgetItem *item = new QTreeWidgetItem(ui->clientTree);
+        item->setText(0, client.address);
+        item->setText(1, QString::number(client.weight));
+        item->setText(2, QString::number(client.active));
+        item->setText(3, tr("%1 (%2 total)").arg(client.queued).arg(client.queuedTotal));
+        item->setText(4, tr("%1 ms").arg(client.averageWait));
+        item->setText(5, tr("%1/s").arg(locale().formattedDataSize(qint64(client.rate))));
+        item->setText(6, locale().formattedDataSize(client.bytes));
+    }
+}
+
+void MainWindow::on_probed(const qint64 &latency, const double &average, const qint64 &p95)
+{
+    probeSpark->add(latency);
+    probeLabel->setText(latency < 0
+                            ? tr("Health check failed")
+                            : tr("Health %1 ms (avg %2, p95 %3)")
+                                  .arg(latency)
+                                  .arg(qRound(average))
+                                  .arg(p95));
+}
+
+void MainWindow::on_sampled(const ResourceSample &sample, const ResourceSample &peak)
+{
+    ui->cpuSpark->add(sample.cpu);
+    ui->memorySpark->add(sample.rss);
+    ui->fdSpark->add(sample.fds);
+    ui->cpuValueLabel->setText(tr("%1% (peak %2%)")
+                                   .arg(sample.cpu, 0, 'f', 1)
+                                   .arg(peak.cpu, 0, 'f', 1));
+    ui->memoryValueLabel->setText(tr("%1 (peak %2)")
+                                      .arg(locale().formattedDataSize(sample.rss),
+                                           locale().formattedDataSize(peak.rss)));
+    ui->fdValueLabel->setText(tr("%1 (peak %2)")
+                                  .arg(sample.fds)
+                                  .arg(peak.fds));
+}
+
+void MainWindow::on_nodeSampled(const NodeSample &sample)
+{
+    ui->loopLagSpark->add(sample.lagP99 / 1000.0);
+    ui->gcSpark->add(sample.gcTime / 1000.0);
+    ui->heapSpark->add(sample.heapUsed);
+    ui->loopLagValueLabel->setText(tr("p99 %1 ms (mean %2, max %3)")
+                                       .arg(sample.lagP99 / 1000.0, 0, 'f', 1)
+                                       .arg(sample.lagMean / 1000.0, 0, 'f', 1)
+                                       .arg(sample.lagMax / 1000.0, 0, 'f', 1));
+    ui->gcValueLabel->setText(tr("%1 ms in %2 (longest %3 ms)")
+                                  .arg(sample.gcTime / 1000.0, 0, 'f', 1)
+                                  .arg(sample.gcCount)
+                                  .arg(sample.gcMax / 1000.0, 0, 'f', 1));
+    ui->heapValueLabel->setText(tr("%1 of %2, %3 handles")
+                                    .arg(locale().formattedDataSize(sample.heapUsed),
+                                         locale().formattedDataSize(sample.heapTotal))
+                                    .arg(sample.handles));
+}
+
+void MainWindow::on_stalled(const qint64 &duration, const int &count, const qint64 &longest, const QStringList &backtrace)
+{
+    ui->stallSpark->add(duration);
+    ui->stallValueLabel->setText(tr("%1 ms (%2 stalls, longest %3 ms)")
+                                     .arg(duration)
+                                     .arg(count)
+                                     .arg(longest));
+    ui->stallValueLabel->setToolTip(backtrace.join(u'\n'));
+}
+
+void MainWindow::on_portsChanged(const QString &ports)
+{
+    const QStringList split = ports.split(u':');
+    ui->httpEdit->setText(split[0]);
+    ui->httpsEdit->setText(split.length() > 1 ? split[1] : u""_s);
+}
+
+void MainWindow::updateDashboard()
+{
+    if (!isVisible() || ui->outTabs->currentWidget() != ui->dashboardTab)
+    {
+        return;
+    }
+    const LogSnapshot snapshot = logMetrics->snapshot();
+    ui->requestRateSpark->setValues(snapshot.requests);
+    ui->requestRateValueLabel->setText(tr("%1/s").arg(snapshot.requestRate, 0, 'f', 2));
+    ui->successRateValueLabel->setText(tr("%1%").arg(snapshot.successRate * 100, 0, 'f', 1));
+    ui->errorRateValueLabel->setText(tr("%1/min").arg(snapshot.errorRate * 60, 0, 'f', 1));
+
+    ui->sourceTree->clear();
+    for (const SourceMetrics &source : snapshot.sources)
+    {
+        QTreeWidgetItem *item = new QTreeWidgetItem(ui->sourceTree);
+        item->setText(0, source.source);
+        item->setText(1, QString::number(source.matches));
+        item->setText(2, tr("%1 ms").arg(source.p50));
+        item->setText(3, tr("%1 ms").arg(source.p90));
+        item->setText(4, tr("%1 ms").arg(source.p99));
+        item->setText(5, tr("%1 ms").arg(source.max));
+    }
+
+    ui->rankingTree->clear();
+    int rank = 0;
+    for (const SourceRank &source : sourceRanking->ranking())
+    {
+        QTreeWidgetItem *item = new QTreeWidgetItem(ui->rankingTree);
+        item->setText(0, source.ranked ? QString::number(++rank) : tr("Untested"));
+        item->setText(1, source.source);
+        item->setText(2, QString::number(qRound(source.lookups)));
+        item->setText(3, tr("%1%").arg(source.lookups > 0 ? source.matches / source.lookups * 100 : 0, 0, 'f', 1));
+        item->setText(4, tr("%1 ms").arg(qRound(source.latency)));
+        item->setText(5, source.ranked ? tr("%1 ms").arg(qRound(source.score)) : QString());
+    }
+}
+
+void MainWindow::updateHistory()
+{
+    if (!isVisible() || ui->outTabs->currentWidget() != ui->historyTab)
+    {
+        return;
+    }
+    const QList<HistoryRecord> records =
+        TimeSeries::read(TimeSeries::Tier(ui->historyRangeComboBox->currentIndex()));
+
+    QList<double> memory, cpu, restarts, latency;
+    qint64 peakRss = 0;
+    double cpuTotal = 0, latencyTotal = 0;
+    quint64 restartTotal = 0, matchTotal = 0;
+    for (const HistoryRecord &record : records)
+    {
+        memory << record.rss;
+        cpu << record.cpu;
+        restarts << record.restarts;
+        latency << record.latency;
+        peakRss = qMax(peakRss, record.rss);
+        cpuTotal += record.cpu;
+        restartTotal += record.restarts;
+        latencyTotal += double(record.latency) * record.matches;
+        matchTotal += record.matches;
+    }
+
+    for (Sparkline *spark : {ui->historyMemorySpark, ui->historyCpuSpark,
+                             ui->historyRestartsSpark, ui->historyLatencySpark})
+    {
+        spark->setCapacity(records.size());
+    }
+    ui->historyMemorySpark->setValues(memory);
+    ui->historyCpuSpark->setValues(cpu);
+    ui->historyRestartsSpark->setValues(restarts);
+    ui->historyLatencySpark->setValues(latency);
+    ui->historyMemoryValueLabel->setText(tr("peak %1").arg(locale().formattedDataSize(peakRss)));
+    ui->historyCpuValueLabel->setText(tr("avg %1%").arg(records.size() ? cpuTotal / records.size() : 0, 0, 'f', 1));
+    ui->historyRestartsValueLabel->setText(tr("%1 total").arg(restartTotal));
+    ui->historyLatencyValueLabel->setText(tr("avg %1 ms").arg(matchTotal ? qRound(latencyTotal / matchTotal) : 0));
 }
 
 void MainWindow::on_installCA()
@@ -200,18 +347,72 @@ void MainWindow::on_installCA()
 
 void MainWindow::on_env()
 {
+    const bool wasPac = config->pacProxy;
+    const bool wasProxy = host->isProxy();
+
     ConfigDialog *configDlg = new ConfigDialog(config, this);
     configDlg->setAttribute(Qt::WA_DeleteOnClose);
     configDlg->setFixedSize(configDlg->sizeHint());
     if (configDlg->exec() == QDialog::Accepted)
     {
         updateSettings();
-        applySettings();
-        ui->outText->clear();
-        emit serverRestart();
+        host->applySettings();
+        logMetrics->loadPatterns();
+        emit settingsChanged();
+        // Move the system proxy over to the new mode
+        if (wasProxy && wasPac != config->pacProxy)
+        {
+            host->setProxy(true);
+        }
+        on_strictChanged(ui->strictCheckBox->checkState());
     }
 }
 
+void MainWindow::on_profile(const Server::ProfileKind &kind)
+{
+    bool ok;
+    const int seconds = QInputDialog::getInt(this, tr("Profile server"),
+                                             tr("Sample the script server for (seconds):"),
+                                             30, 5, 600, 5, &ok);
+    if (ok)
+    {
+        ui->outTabs->setCurrentWidget(ui->logTab);
+        emit serverProfile(kind, seconds);
+    }
+}
+
+void MainWindow::on_saveProfile()
+{
+    bool ok;
+    const QString name = QInputDialog::getText(this, tr("Save profile"),
+                                               tr("Save the sources and account options as:"),
+                                               QLineEdit::Normal, config->profile, &ok)
+                             .remove(u'/')
+                             .remove(u'\\')
+                             .trimmed();
+    if (ok && name.size())
+    {
+        on_apply();
+        host->saveProfile(name);
+    }
+}
+
+void MainWindow::updateProfileMenu()
+{
+    qDeleteAll(profileActions);
+    profileActions.clear();
+    for (const QString &name : config->profiles.keys())
+    {
+        QAction *action = ui->menuProfiles->addAction(name);
+        action->setCheckable(true);
+        action->setChecked(name == config->profile);
+        connect(action, &QAction::triggered, this, [this, name]
+                { host->switchProfile(name); });
+        profileActions << action;
+    }
+    ui->actionDeleteProfile->setEnabled(config->profiles.contains(config->profile));
+}
+
 void MainWindow::on_about()
 {
     const QPixmap logo =
@@ -256,24 +457,28 @@ void MainWindow::on_aboutQt()
 
 void MainWindow::on_apply()
 {
-    qDebug("---Restarting server---");
-    const bool wasProxy = isProxy();
+    const bool wasProxy = host->isProxy();
     updateSettings();
-    ui->outText->clear();
-    emit serverRestart();
+    emit settingsChanged();
     if (wasProxy)
     {
-        setProxy(true);
+        host->setProxy(true);
     }
 }
 
 void MainWindow::on_strictChanged(Qt::CheckState state)
 {
+    // Auto-config only sends music hosts, which strict mode allows
+    if (config->pacProxy)
+    {
+        ui->proxyCheckBox->setEnabled(true);
+        return;
+    }
     ui->proxyCheckBox->setEnabled(state != Qt::Checked);
-    if (isProxy() && state == Qt::Checked)
+    if (host->isProxy() && state == Qt::Checked)
     {
         ui->proxyCheckBox->setChecked(false);
-        setProxy(false);
+        host->setProxy(false);
     }
 }
 
@@ -281,19 +486,17 @@ void MainWindow::loadSettings()
 {
     qDebug("Loading settings");
 
-    // load settings from file into variables
-    config->readSettings();
-
     // load settings from variables into ui
-    const QStringList split = config->params[Param::Port].value<QString>().split(u':');
+    const QStringList split = config->ports().split(u':');
     ui->httpEdit->setText(split[0]);
     ui->httpsEdit->setText(split.length() > 1 ? split[1] : u""_s);
     ui->addressEdit->setText(config->params[Param::Address].value<QString>());
     ui->urlEdit->setText(config->params[Param::Url].value<QString>());
     ui->hostEdit->setText(config->params[Param::Host].value<QString>());
-    ui->sourceEdit->append(config->params[Param::Sources].value<QStringList>().join(u", "_s));
+    ui->sourceEdit->setPlainText(config->params[Param::Sources].value<QStringList>().join(u", "_s));
     ui->strictCheckBox->setChecked(config->params[Param::Strict].value<bool>());
     ui->debugCheckBox->setChecked(config->debugInfo);
+    ui->autoSourcesCheckBox->setChecked(config->autoSources);
     setTheme(config->theme);
 
     qDebug("Load settings done");
@@ -309,13 +512,18 @@ void MainWindow::updateSettings()
     const QString port = ui->httpsEdit->text().size()
                              ? ui->httpEdit->text() + u':' + ui->httpsEdit->text()
                              : ui->httpEdit->text();
-    config->params[Param::Port].setValue(port);
+    // Ports the server moved to are shown, but only a new choice is kept
+    if (port != config->ports())
+    {
+        config->params[Param::Port].setValue(port);
+    }
     config->params[Param::Address].setValue(ui->addressEdit->text());
     config->params[Param::Url].setValue(ui->urlEdit->text());
     config->params[Param::Host].setValue(ui->hostEdit->text());
     config->params[Param::Sources].setValue(ui->sourceEdit->toPlainText().split(sep, Qt::SkipEmptyParts));
     config->params[Param::Strict].setValue(ui->strictCheckBox->isChecked());
     config->debugInfo = ui->debugCheckBox->isChecked();
+    config->autoSources = ui->autoSourcesCheckBox->isChecked();
     config->theme = QApplication::style()->name();
 
     // write settings from variables into file
@@ -324,12 +532,11 @@ void MainWindow::updateSettings()
     qDebug("Update settings done");
 }
 
-void MainWindow::applySettings()
+// The settings were read again outside the window
+void MainWindow::reloadSettings()
 {
-#ifdef Q_OS_WIN
-    WinUtils::setStartup(config->startup,
-                         config->startMinimized);
-#endif
+    loadSettings();
+    on_strictChanged(ui->strictCheckBox->checkState());
 }
 
 // Event reloads
@@ -373,7 +580,7 @@ bool MainWindow::event(QEvent *e)
     // Update proxy checkbox on window activation
     case QEvent::WindowActivate:
     {
-        ui->proxyCheckBox->setChecked(isProxy());
+        ui->proxyCheckBox->setChecked(host->isProxy());
         break;
     }
 
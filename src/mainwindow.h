@@ -1,10 +1,16 @@
 #pragma once
 
 #include "config/config.h"
+#include "frontproxy.h"
+#include "logmetrics.h"
+#include "logstore.h"
 #include "server.h"
+#include "sourceranking.h"
+#include "sparkline.h"
 
 #include <QLabel>
 #include <QMainWindow>
+#include <QTimer>
 
 QT_BEGIN_NAMESPACE
 namespace Ui
@@ -13,41 +19,61 @@ namespace Ui
 }
 QT_END_NAMESPACE
 
+class WindowHost;
+
 class MainWindow : public QMainWindow
 {
     Q_OBJECT
 
 public:
-    MainWindow(Config *config);
+    MainWindow(Config *config, LogMetrics *logMetrics, SourceRanking *sourceRanking,
+               LogStore *logStore, WindowHost *host);
     ~MainWindow();
-    bool setProxy(const bool &enable);
-    bool isProxy();
     void gotUpdateStatus(const bool &isNewVersion, const QString &version, const QString &openUrl);
+    void loadSettings();
+    void updateSettings();
+    void reloadSettings();
 
 public slots:
-    void exit();
     void on_serverOut(const QString &message);
-    void on_serverErr(const QString &message);
+    void on_proxyStats(const quint64 &lookups, const quint64 &hits, const quint64 &coalesced);
+    void on_hedgeStats(const quint64 &fired, const quint64 &wins, const qint64 &savedMs);
+    void on_clientStats(const QList<ClientStats> &stats);
+    void on_probed(const qint64 &latency, const double &average, const qint64 &p95);
+    void on_sampled(const ResourceSample &sample, const ResourceSample &peak);
+    void on_nodeSampled(const NodeSample &sample);
+    void on_stalled(const qint64 &duration, const int &count, const qint64 &longest, const QStringList &backtrace);
+    void on_portsChanged(const QString &ports);
 
 signals:
-    void serverRestart();
-    void serverClose();
+    void settingsChanged();
+    void serverProfile(const Server::ProfileKind &kind, const int &seconds);
 
 private:
     Ui::MainWindow *ui;
-    Server *server;
     Config *config;
+    LogMetrics *logMetrics;
+    SourceRanking *sourceRanking;
+    WindowHost *host;
+    QTimer *dashboardTimer;
     QLabel *statusLabel;
+    QLabel *cacheLabel;
+    QLabel *hedgeLabel;
+    QLabel *probeLabel;
+    Sparkline *probeSpark;
+    QList<QAction *> profileActions;
 
     void setTheme(const QString &theme);
     bool event(QEvent *e);
-    void loadSettings();
-    void updateSettings();
-    void applySettings();
+    void updateDashboard();
+    void updateHistory();
+    void updateProfileMenu();
 
 private slots:
     void on_installCA();
     void on_env();
+    void on_profile(const Server::ProfileKind &kind);
+    void on_saveProfile();
     void on_about();
     void on_aboutQt();
     void on_apply();
@@ -0,0 +1,189 @@
+#include "metrics.h"
+
+#include <chrono>
+#include <cstring>
+
+Metric *Metric::first = nullptr;
+Metric *Metric::last = nullptr;
+LabeledCounter *LabeledCounter::first = nullptr;
+LabeledCounter *LabeledCounter::last = nullptr;
+
+static qint64 now()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+static QByteArray escape(const QByteArray &value)
+{
+    QByteArray escaped = value;
+    return escaped.replace('\\', "\\\\").replace('"', "\\\"").replace('\n', "\\n");
+}
+
+Metric::Metric(const char *name, const char *help, const Type &type, const double &scale)
+    : name(name), help(help), type(type), scale(scale), current(0), next(nullptr)
+{
+    (last ? last->next : first) = this;
+    last = this;
+}
+
+Metric::~Metric()
+{
+}
+
+void Metric::start()
+{
+    set(now());
+}
+
+// Prometheus text format
+QByteArray Metric::exportAll()
+{
+    QByteArray text;
+    for (const Metric *metric = first; metric; metric = metric->next)
+    {
+        const qint64 value = metric->current.load(std::memory_order_relaxed);
+        text += "# HELP " + QByteArray(metric->name) + ' ' + metric->help + '\n';
+        text += "# TYPE " + QByteArray(metric->name) + (metric->type == Counter ? " counter\n" : " gauge\n");
+        text += metric->name;
+        if (metric->type == Since)
+        {
+            text += ' ' + QByteArray::number(value ? (now() - value) / 1000.0 : 0, 'f', 3) + '\n';
+        }
+        else if (metric->scale != 1)
+        {
+            text += ' ' + QByteArray::number(value * metric->scale, 'f', 3) + '\n';
+        }
+        else
+        {
+            text += ' ' + QByteArray::number(value) + '\n';
+        }
+    }
+    return text + LabeledCounter::exportAll();
+}
+
+QJsonObject Metric::exportJson()
+{
+    QJsonObject object;
+    for (const Metric *metric = first; metric; metric = metric->next)
+    {
+        const qint64 value = metric->current.load(std::memory_order_relaxed);
+        if (metric->type == Since)
+        {
+            object.insert(QLatin1StringView(metric->name), value ? (now() - value) / 1000.0 : 0);
+        }
+        else
+        {
+            object.insert(QLatin1StringView(metric->name), value * metric->scale);
+        }
+    }
+    return object;
+}
+
+LabeledCounter::LabeledCounter(const char *name, const char *help, const char *label)
+    : name(name), help(help), label(label), next(nullptr)
+{
+    (last ? last->next : first) = this;
+    last = this;
+}
+
+LabeledCounter::~LabeledCounter()
+{
+}
+
+void LabeledCounter::add(const QByteArray &value, const qint64 &n)
+{
+    const QByteArray key = value.first(qMin(value.size(), qsizetype(LabelSize - 1)));
+    for (Slot &slot : slots)
+    {
+        int state = slot.state.load(std::memory_order_acquire);
+        if (state == Empty)
+        {
+            // Claim the slot, or see what another thread put there
+            if (slot.state.compare_exchange_strong(state, Claimed, std::memory_order_acquire))
+            {
+                std::memcpy(slot.value, key.constData(), key.size());
+                slot.count.fetch_add(n, std::memory_order_relaxed);
+                slot.state.store(Ready, std::memory_order_release);
+                return;
+            }
+        }
+        // Another thread is writing the label, it may be the same one
+        while (state == Claimed)
+        {
+            state = slot.state.load(std::memory_order_acquire);
+        }
+        if (key == slot.value)
+        {
+            slot.count.fetch_add(n, std::memory_order_relaxed);
+            return;
+        }
+    }
+    // All slots taken, the value goes uncounted
+}
+
+QByteArray LabeledCounter::exportAll()
+{
+    QByteArray text;
+    for (const LabeledCounter *counter = first; counter; counter = counter->next)
+    {
+        text += "# HELP " + QByteArray(counter->name) + ' ' + counter->help + '\n';
+        text += "# TYPE " + QByteArray(counter->name) + " counter\n";
+        for (const Slot &slot : counter->slots)
+        {
+            if (slot.state.load(std::memory_order_acquire) != Ready)
+            {
+                continue;
+            }
+            text += QByteArray(counter->name) + '{' + counter->label + "=\"" +
+                    escape(slot.value) + "\"} " +
+                    QByteArray::number(slot.count.load(std::memory_order_relaxed)) + '\n';
+        }
+    }
+    return text;
+}
+
+namespace Metrics
+{
+    Metric serverUptime("unm_server_uptime_seconds", "Time since the server was started.", Metric::Since);
+    Metric serverRestarts("unm_server_restarts_total", "Restarts of the server.", Metric::Counter);
+    Metric serverRss("unm_server_resident_memory_bytes", "Resident memory of the server.", Metric::Gauge);
+    Metric serverCpu("unm_server_cpu_percent", "CPU usage of the server, 100 per busy core.", Metric::Gauge, 0.001);
+    Metric serverOpenFiles("unm_server_open_files", "Open files or handles of the server.", Metric::Gauge);
+    Metric serverLoopLag("unm_server_event_loop_lag_seconds", "99th percentile event loop delay of the script server.", Metric::Gauge, 0.000001);
+    Metric serverLoopLagMax("unm_server_event_loop_lag_max_seconds", "Longest event loop delay of the script server in the last interval.", Metric::Gauge, 0.000001);
+    Metric serverGcPauses("unm_server_gc_pauses_total", "Garbage collections of the script server.", Metric::Counter);
+    Metric serverGcTime("unm_server_gc_pause_seconds_total", "Time the script server spent in garbage collection.", Metric::Counter, 0.000001);
+    Metric serverHeapUsed("unm_server_heap_used_bytes", "JavaScript heap used by the script server.", Metric::Gauge);
+    Metric serverHeapTotal("unm_server_heap_total_bytes", "JavaScript heap allocated by the script server.", Metric::Gauge);
+    Metric serverHandles("unm_server_active_handles", "Active handles and requests of the script server.", Metric::Gauge);
+    Metric systemLogSent("unm_system_log_sent_total", "Messages sent to the system log.", Metric::Counter);
+    Metric systemLogDropped("unm_system_log_dropped_total", "Messages dropped because the system log was busy or gone.", Metric::Counter);
+    Metric serverReady("unm_server_ready_seconds", "Time the server took to answer its first health check.", Metric::Gauge, 0.001);
+    Metric logLines("unm_log_lines_total", "Lines logged by the server.", Metric::Counter);
+    Metric logLineRate("unm_log_lines_per_second", "Lines logged by the server per second over the last minute.", Metric::Gauge, 0.001);
+    Metric logErrors("unm_log_errors_total", "Error lines logged by the server.", Metric::Counter);
+    Metric lookups("unm_lookups_total", "Song lookups seen in the server log.", Metric::Counter);
+    Metric lookupFailures("unm_lookup_failures_total", "Song lookups without a match.", Metric::Counter);
+    Metric matches("unm_matches_total", "Song lookups matched by any source.", Metric::Counter);
+    Metric matchLatency("unm_match_latency_seconds_total", "Total time from lookup to match.", Metric::Counter, 0.001);
+    LabeledCounter sourceMatches("unm_source_matches_total", "Song lookups matched by each source.", "source");
+    Metric systemProxy("unm_system_proxy_enabled", "Whether the system proxy points at the server.", Metric::Gauge);
+    Metric frontProxy("unm_front_proxy_enabled", "Whether the front proxy is enabled.", Metric::Gauge);
+    Metric pacProxy("unm_pac_enabled", "Whether the system proxy uses the PAC script.", Metric::Gauge);
+    Metric proxyConnections("unm_front_proxy_connections", "Open client connections of the front proxy.", Metric::Gauge);
+    Metric proxyLookups("unm_front_proxy_lookups_total", "Song URL lookups through the front proxy.", Metric::Counter);
+    Metric proxyCacheHits("unm_front_proxy_cache_hits_total", "Lookups answered from the front proxy cache.", Metric::Counter);
+    Metric proxyCoalesced("unm_front_proxy_coalesced_total", "Lookups joined to one already in flight.", Metric::Counter);
+    Metric startupTray("unm_startup_tray_seconds", "Time from launch to the tray icon.", Metric::Gauge, 0.001);
+    Metric startupReady("unm_startup_ready_seconds", "Time from launch to the first ready server.", Metric::Gauge, 0.001);
+    Metric guiStalls("unm_gui_stalls_total", "Times the GUI event loop stalled beyond the threshold.", Metric::Counter);
+    Metric guiStallTime("unm_gui_stall_seconds_total", "Total time the GUI event loop was stalled.", Metric::Counter, 0.001);
+    Metric windowBuilt("unm_window_built", "Whether the main window currently exists.", Metric::Gauge);
+    Metric profileSwitch("unm_profile_switch_seconds", "Time the last switch to a pre-started profile took.", Metric::Gauge, 0.000001);
+    Metric networkChanges("unm_network_changes_total", "Network changes the server was restarted for.", Metric::Counter);
+    Metric networkRecovery("unm_network_recovery_seconds", "Time from the last network change to a working server.", Metric::Gauge, 0.001);
+    Metric warmUp("unm_warmup_seconds", "Time the last warm-up took, 0 without one.", Metric::Gauge, 0.001);
+    Metric firstMatch("unm_first_match_seconds", "Latency of the first song matched after the server started.", Metric::Gauge, 0.001);
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <QByteArray>
+#include <QJsonObject>
+
+#include <atomic>
+
+// Process-wide metric, updated with relaxed atomics from any thread.
+// Metrics are static objects linked into a list during static
+// initialization, so the registry itself never needs a lock.
+class Metric
+{
+public:
+    enum Type
+    {
+        Counter,
+        Gauge,
+        // Exported as seconds since start() was called
+        Since
+    };
+
+    Metric(const char *name, const char *help, const Type &type, const double &scale = 1);
+    ~Metric();
+
+    void add(const qint64 &n = 1)
+    {
+        current.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    void set(const qint64 &value)
+    {
+        current.store(value, std::memory_order_relaxed);
+    }
+
+    qint64 value() const
+    {
+        return current.load(std::memory_order_relaxed);
+    }
+
+    void start();
+
+    static QByteArray exportAll();
+    // Metric names with their exported values
+    static QJsonObject exportJson();
+
+private:
+    const char *name;
+    const char *help;
+    Type type;
+    double scale;
+    std::atomic<qint64> current;
+    Metric *next;
+
+    static Metric *first;
+    static Metric *last;
+};
+
+// Counters by one label, in a fixed number of slots claimed without locks
+class LabeledCounter
+{
+public:
+    LabeledCounter(const char *name, const char *help, const char *label);
+    ~LabeledCounter();
+
+    void add(const QByteArray &value, const qint64 &n = 1);
+
+    static QByteArray exportAll();
+
+private:
+    static constexpr int Slots = 32;
+    static constexpr int LabelSize = 32;
+
+    enum State
+    {
+        Empty,
+        Claimed,
+        Ready
+    };
+
+    struct Slot
+    {
+        std::atomic<int> state{Empty};
+        char value[LabelSize] = {};
+        std::atomic<qint64> count{0};
+    };
+
+    const char *name;
+    const char *help;
+    const char *label;
+    Slot slots[Slots];
+    LabeledCounter *next;
+
+    static LabeledCounter *first;
+    static LabeledCounter *last;
+};
+
+namespace Metrics
+{
+    extern Metric serverUptime;
+    extern Metric serverRestarts;
+    extern Metric serverRss;
+    extern Metric serverCpu;
+    extern Metric serverOpenFiles;
+    extern Metric serverLoopLag;
+    extern Metric serverLoopLagMax;
+    extern Metric serverGcPauses;
+    extern Metric serverGcTime;
+    extern Metric serverHeapUsed;
+    extern Metric serverHeapTotal;
+    extern Metric serverHandles;
+    extern Metric systemLogSent;
+    extern Metric systemLogDropped;
+    extern Metric serverReady;
+    extern Metric logLines;
+    extern Metric logLineRate;
+    extern Metric logErrors;
+    extern Metric lookups;
+    extern Metric lookupFailures;
+    extern LabeledCounter sourceMatches;
+    extern Metric matches;
+    extern Metric matchLatency;
+    extern Metric systemProxy;
+    extern Metric frontProxy;
+    extern Metric pacProxy;
+    extern Metric proxyConnections;
+    extern Metric proxyLookups;
+    extern Metric proxyCacheHits;
+    extern Metric proxyCoalesced;
+    extern Metric startupTray;
+    extern Metric startupReady;
+    extern Metric guiStalls;
+    extern Metric guiStallTime;
+    extern Metric windowBuilt;
+    extern Metric profileSwitch;
+    extern Metric networkChanges;
+    extern Metric networkRecovery;
+    extern Metric warmUp;
+    extern Metric firstMatch;
+}
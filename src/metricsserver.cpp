@@ -0,0 +1,47 @@
+#include "metricsserver.h"
+#include "metrics.h"
+
+#include <QHostAddress>
+
+using namespace Qt::StringLiterals;
+
+MetricsServer::MetricsServer(Config *config)
+    : HttpEndpoint(), config(config)
+{
+    route("/metrics"_ba, [this](QByteArray &contentType)
+          {
+              // Settings only change on this thread
+              Metrics::frontProxy.set(this->config->frontProxy);
+              Metrics::pacProxy.set(this->config->pacProxy);
+              contentType = "text/plain; version=0.0.4; charset=utf-8"_ba;
+              return Metric::exportAll(); });
+}
+
+MetricsServer::~MetricsServer()
+{
+}
+
+void MetricsServer::start()
+{
+    if (!config->metrics || isListening())
+    {
+        return;
+    }
+    if (!listen(QHostAddress::LocalHost, config->metricsPort))
+    {
+        emit out(tr("Metrics server failed to listen on port %1: %2")
+                     .arg(config->metricsPort)
+                     .arg(errorString()));
+    }
+}
+
+void MetricsServer::stop()
+{
+    close();
+}
+
+void MetricsServer::restart()
+{
+    stop();
+    start();
+}
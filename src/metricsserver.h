@@ -0,0 +1,25 @@
+#pragma once
+
+#include "config/config.h"
+#include "httpendpoint.h"
+
+// Serves the metrics registry in Prometheus text format on loopback
+class MetricsServer : public HttpEndpoint
+{
+    Q_OBJECT
+
+public:
+    MetricsServer(Config *config);
+    ~MetricsServer();
+
+public slots:
+    void start();
+    void stop();
+    void restart();
+
+signals:
+    void out(const QString &message);
+
+private:
+    Config *config;
+};
@@ -0,0 +1,174 @@
+#include "networkwatcher.h"
+#include "trace.h"
+
+#include <QDateTime>
+#include <QNetworkInformation>
+#include <QNetworkInterface>
+
+#ifdef Q_OS_LINUX
+#include "utils/linuxutils.h"
+#include <unistd.h>
+#endif
+
+using namespace Qt::StringLiterals;
+
+// Quiet time before a burst of events counts as one change
+static constexpr int SettleDelay = 2000;
+// Clock check period; without netlink, also the address check period
+static constexpr int ClockInterval = 5000;
+// Clock jumps longer than this are taken as a resume from sleep
+static constexpr qint64 ResumeGap = 30000;
+
+NetworkWatcher::NetworkWatcher(Config *config)
+    : QObject(), config(config), settleTimer(new QTimer(this)),
+      clockTimer(new QTimer(this)), lastTick(0), lastWallTick(0),
+      since(0), forced(false), notifier(nullptr), netlink(-1)
+{
+    settleTimer->setSingleShot(true);
+    settleTimer->setInterval(SettleDelay);
+    connect(settleTimer, &QTimer::timeout, this, &NetworkWatcher::settle);
+    connect(clockTimer, &QTimer::timeout, this, &NetworkWatcher::tick);
+    clock.start();
+
+    if (QNetworkInformation::loadBackendByFeatures(QNetworkInformation::Feature::Reachability))
+    {
+        QNetworkInformation *info = QNetworkInformation::instance();
+        connect(info, &QNetworkInformation::reachabilityChanged, this, [this]
+                { note(u"connectivity"_s, true); });
+        connect(info, &QNetworkInformation::transportMediumChanged, this, [this]
+                { note(u"transport"_s, true); });
+    }
+}
+
+NetworkWatcher::~NetworkWatcher()
+{
+    stop();
+}
+
+void NetworkWatcher::start()
+{
+    if (!config->networkRecovery || clockTimer->isActive())
+    {
+        return;
+    }
+    addresses = addressKey();
+    lastTick = clock.elapsed();
+    lastWallTick = QDateTime::currentMSecsSinceEpoch();
+    clockTimer->start(ClockInterval);
+#ifdef Q_OS_LINUX
+    netlink = LinuxUtils::openNetlink();
+    if (netlink >= 0)
+    {
+        notifier = new QSocketNotifier(netlink, QSocketNotifier::Read, this);
+        connect(notifier, &QSocketNotifier::activated, this, [this]
+                { if (LinuxUtils::readNetlink(netlink))
+                      note(u"addresses"_s, false); });
+    }
+#endif
+}
+
+void NetworkWatcher::stop()
+{
+    clockTimer->stop();
+    settleTimer->stop();
+    since = 0;
+    forced = false;
+    reason.clear();
+    delete notifier;
+    notifier = nullptr;
+#ifdef Q_OS_LINUX
+    if (netlink >= 0)
+    {
+        ::close(netlink);
+    }
+#endif
+    netlink = -1;
+}
+
+void NetworkWatcher::reload()
+{
+    config->networkRecovery ? start() : stop();
+}
+
+void NetworkWatcher::note(const QString &why, const bool &force)
+{
+    if (!clockTimer->isActive())
+    {
+        return;
+    }
+    if (!since)
+    {
+        since = Trace::now();
+    }
+    if (!reason.contains(why))
+    {
+        reason += reason.isEmpty() ? why : u", "_s + why;
+    }
+    forced = forced || force;
+    settleTimer->start();
+}
+
+void NetworkWatcher::settle()
+{
+    // Wait for the network to come back, its change restarts the wait
+    const QNetworkInformation *info = QNetworkInformation::instance();
+    if (info && info->reachability() == QNetworkInformation::Reachability::Disconnected)
+    {
+        return;
+    }
+    const QString key = addressKey();
+    const bool moved = key != addresses;
+    addresses = key;
+    // Links flapping back to the same addresses keep their connections
+    if (moved || forced)
+    {
+        emit changed(reason, since);
+    }
+    since = 0;
+    forced = false;
+    reason.clear();
+}
+
+void NetworkWatcher::tick()
+{
+    // The monotonic clock stops during sleep on some systems, the wall clock does not
+    const qint64 now = clock.elapsed();
+    const qint64 wallNow = QDateTime::currentMSecsSinceEpoch();
+    const qint64 gap = qMax(now - lastTick, wallNow - lastWallTick) - ClockInterval;
+    lastTick = now;
+    lastWallTick = wallNow;
+    if (gap > ResumeGap)
+    {
+        note(u"resume"_s, true);
+    }
+    else if (netlink < 0 && !settleTimer->isActive() && addressKey() != addresses)
+    {
+        note(u"addresses"_s, false);
+    }
+}
+
+// Addresses of the interfaces that are up, without the ones that come
+// and go on their own: loopback, link-local and temporary IPv6 addresses
+QString NetworkWatcher::addressKey()
+{
+    QStringList entries;
+    for (const QNetworkInterface &networkInterface : QNetworkInterface::allInterfaces())
+    {
+        const QNetworkInterface::InterfaceFlags flags = networkInterface.flags();
+        if (!(flags & QNetworkInterface::IsUp) || !(flags & QNetworkInterface::IsRunning) ||
+            (flags & QNetworkInterface::IsLoopBack))
+        {
+            continue;
+        }
+        for (const QNetworkAddressEntry &entry : networkInterface.addressEntries())
+        {
+            if (entry.isTemporary() || entry.ip().isLinkLocal())
+            {
+                continue;
+            }
+            entries << networkInterface.name() + u'=' + entry.ip().toString();
+        }
+    }
+    entries.sort();
+    return entries.join(u' ');
+}
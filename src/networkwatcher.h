@@ -0,0 +1,48 @@
+#pragma once
+
+#include "config/config.h"
+
+#include <QElapsedTimer>
+#include <QSocketNotifier>
+#include <QTimer>
+
+// Reports network changes that leave the server with dead keep-alive
+// connections and stale lookups: connectivity or transport changes,
+// interface address changes and resume from sleep. A burst of events is
+// reported once, after the network settled and is reachable again.
+class NetworkWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    NetworkWatcher(Config *config);
+    ~NetworkWatcher();
+
+public slots:
+    void start();
+    void stop();
+    void reload();
+
+signals:
+    // since is the Trace::now() of the first event of the burst
+    void changed(const QString &reason, const qint64 &since);
+
+private:
+    Config *config;
+    QTimer *settleTimer;
+    QTimer *clockTimer;
+    QElapsedTimer clock;
+    qint64 lastTick;
+    qint64 lastWallTick;
+    QString addresses;
+    QString reason;
+    qint64 since;
+    bool forced;
+    QSocketNotifier *notifier;
+    int netlink;
+
+    void note(const QString &why, const bool &force);
+    void settle();
+    void tick();
+    static QString addressKey();
+};
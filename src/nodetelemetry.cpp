@@ -0,0 +1,202 @@
+#include "nodetelemetry.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#ifdef Q_OS_LINUX
+#include "utils/linuxutils.h"
+#endif
+
+using namespace Qt::StringLiterals;
+
+// Record format version, the first field of each line
+static constexpr char RecordVersion[] = "1";
+static constexpr int RecordFields = 10;
+// A line longer than this is not a record
+static constexpr qsizetype MaxPartial = 64 * 1024;
+
+// Preloaded into node. Writes never block the server: a full pipe
+// drops the record, a closed one ends the reporting.
+static constexpr char TelemetryScript[] = R"(// Written by QtUnblockNeteaseMusic
+const fs = require('fs');
+const { monitorEventLoopDelay, PerformanceObserver } = require('perf_hooks');
+const fd = Number(process.env.UNM_TELEMETRY_FD);
+const interval = Number(process.env.UNM_TELEMETRY_MS) || 2000;
+// Processes started by the server do not report
+process.env.NODE_OPTIONS = (process.env.NODE_OPTIONS || '').replace(`--require "${__filename}"`, '').trim();
+delete process.env.UNM_TELEMETRY_FD;
+const delay = monitorEventLoopDelay({ resolution: 10 });
+delay.enable();
+let gcCount = 0, gcTime = 0, gcMax = 0;
+new PerformanceObserver(list => {
+  for (const entry of list.getEntries()) {
+    gcCount++;
+    gcTime += entry.duration;
+    gcMax = Math.max(gcMax, entry.duration);
+  }
+}).observe({ entryTypes: ['gc'] });
+const us = (value, scale) => Math.round(value * scale) || 0;
+const timer = setInterval(() => {
+  const memory = process.memoryUsage();
+  const handles = process.getActiveResourcesInfo
+    ? process.getActiveResourcesInfo().length
+    : process._getActiveHandles().length + process._getActiveRequests().length;
+  const line = [1, us(delay.mean, 1e-3), us(delay.percentile(99), 1e-3), us(delay.max, 1e-3),
+    gcCount, us(gcTime, 1e3), us(gcMax, 1e3), memory.heapUsed, memory.heapTotal, handles].join(' ');
+  delay.reset();
+  gcCount = gcTime = gcMax = 0;
+  try {
+    fs.writeSync(fd, line + '\n');
+  } catch (err) {
+    if (err.code !== 'EAGAIN') clearInterval(timer);
+  }
+}, interval);
+timer.unref();
+)";
+
+NodeTelemetry::NodeTelemetry(Config *config, QObject *parent)
+    : QObject(parent), config(config), readFd(-1), writeFd(-1), notifier(nullptr)
+{
+    qRegisterMetaType<NodeSample>();
+}
+
+NodeTelemetry::~NodeTelemetry()
+{
+    stop();
+}
+
+// Have node load the preload, for the script server only
+void NodeTelemetry::addEnvironment(QProcessEnvironment &env)
+{
+#ifdef Q_OS_LINUX
+    if (!config->telemetry)
+    {
+        return;
+    }
+    const QString script = scriptPath();
+    if (script.isEmpty())
+    {
+        return;
+    }
+    const QString options = env.value(u"NODE_OPTIONS"_s);
+    env.insert(u"NODE_OPTIONS"_s, (options + u" --require \"%1\""_s.arg(script)).trimmed());
+    env.insert(u"UNM_TELEMETRY_FD"_s, QString::number(ChildFd));
+    env.insert(u"UNM_TELEMETRY_MS"_s, QString::number(qMax(config->monitorInterval, 1) * 1000));
+#else
+    Q_UNUSED(env)
+#endif
+}
+
+// A new pipe for the next child, its write end or -1
+int NodeTelemetry::open()
+{
+    stop();
+#ifdef Q_OS_LINUX
+    if (!LinuxUtils::createPipe(readFd, writeFd))
+    {
+        readFd = writeFd = -1;
+    }
+#endif
+    return writeFd;
+}
+
+// The child holds the write end now, so the end of the child ends the stream
+void NodeTelemetry::started()
+{
+#ifdef Q_OS_LINUX
+    if (writeFd < 0)
+    {
+        return;
+    }
+    LinuxUtils::closeFd(writeFd);
+    writeFd = -1;
+    notifier = new QSocketNotifier(readFd, QSocketNotifier::Read, this);
+    connect(notifier, &QSocketNotifier::activated, this, &NodeTelemetry::on_readable);
+#endif
+}
+
+void NodeTelemetry::stop()
+{
+    delete notifier;
+    notifier = nullptr;
+    partial.clear();
+#ifdef Q_OS_LINUX
+    for (int *fd : {&readFd, &writeFd})
+    {
+        if (*fd >= 0)
+        {
+            LinuxUtils::closeFd(*fd);
+            *fd = -1;
+        }
+    }
+#endif
+}
+
+// Written once per run into a directory only this user can write,
+// since node runs whatever the file holds
+QString NodeTelemetry::scriptPath()
+{
+    static QString path;
+#ifdef Q_OS_LINUX
+    if (path.isEmpty())
+    {
+        QString dir = QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation);
+        if (dir.isEmpty())
+        {
+            dir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation);
+        }
+        if (dir.isEmpty() || !QDir().mkpath(dir) ||
+            !QFile::setPermissions(dir, QFile::ReadOwner | QFile::WriteOwner | QFile::ExeOwner))
+        {
+            return path;
+        }
+        // Replaced by a rename, so a link planted in its place is not followed
+        QSaveFile script(QDir(dir).filePath(QCoreApplication::applicationName() + u"-telemetry.js"_s));
+        if (script.open(QIODevice::WriteOnly) && script.write(TelemetryScript) >= 0 &&
+            script.commit() && LinuxUtils::isPrivate(script.fileName()))
+        {
+            path = script.fileName();
+        }
+    }
+#endif
+    return path;
+}
+
+void NodeTelemetry::on_readable()
+{
+#ifdef Q_OS_LINUX
+    if (LinuxUtils::readFd(readFd, partial) == 0)
+    {
+        stop();
+        return;
+    }
+#endif
+    qsizetype end;
+    while ((end = partial.indexOf('\n')) >= 0)
+    {
+        const QList<QByteArray> fields = partial.first(end).split(' ');
+        partial.remove(0, end + 1);
+        if (fields.size() < RecordFields || fields[0] != RecordVersion)
+        {
+            continue;
+        }
+        NodeSample sample;
+        sample.lagMean = fields[1].toLongLong();
+        sample.lagP99 = fields[2].toLongLong();
+        sample.lagMax = fields[3].toLongLong();
+        sample.gcCount = fields[4].toInt();
+        sample.gcTime = fields[5].toLongLong();
+        sample.gcMax = fields[6].toLongLong();
+        sample.heapUsed = fields[7].toLongLong();
+        sample.heapTotal = fields[8].toLongLong();
+        sample.handles = fields[9].toInt();
+        emit sampled(sample);
+    }
+    if (partial.size() > MaxPartial)
+    {
+        partial.clear();
+    }
+}
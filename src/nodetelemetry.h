@@ -0,0 +1,53 @@
+#pragma once
+
+#include "config/config.h"
+
+#include <QProcessEnvironment>
+#include <QSocketNotifier>
+
+struct NodeSample
+{
+    // Event loop delay over the last interval, in microseconds
+    qint64 lagMean = 0;
+    qint64 lagP99 = 0;
+    qint64 lagMax = 0;
+    // Garbage collections in the last interval, pauses in microseconds
+    int gcCount = 0;
+    qint64 gcTime = 0;
+    qint64 gcMax = 0;
+    qint64 heapUsed = 0;
+    qint64 heapTotal = 0;
+    int handles = 0;
+};
+
+// Telemetry from inside the script server. A preload samples Node's
+// event loop delay, GC pauses, heap and active handles, and writes one
+// line of numbers per interval to a pipe inherited as fd 3.
+class NodeTelemetry : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int ChildFd = 3;
+
+    NodeTelemetry(Config *config, QObject *parent);
+    ~NodeTelemetry();
+
+    void addEnvironment(QProcessEnvironment &env);
+    int open();
+    void started();
+    void stop();
+
+signals:
+    void sampled(const NodeSample &sample);
+
+private:
+    Config *config;
+    int readFd;
+    int writeFd;
+    QSocketNotifier *notifier;
+    QByteArray partial;
+
+    static QString scriptPath();
+    void on_readable();
+};
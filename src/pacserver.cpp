@@ -0,0 +1,90 @@
+#include "pacserver.h"
+
+#include <QHostAddress>
+
+using namespace Qt::StringLiterals;
+
+// Hosts hooked by the server, see UnblockNeteaseMusic/server src/hook.js
+static const QStringList MusicHosts = {
+    u"music.163.com"_s,
+    u"interface.music.163.com"_s,
+    u"interface3.music.163.com"_s,
+    u"interfacepc.music.163.com"_s,
+    u"apm.music.163.com"_s,
+    u"apm3.music.163.com"_s,
+    u"interface.music.163.com.163jiasu.com"_s,
+    u"interface3.music.163.com.163jiasu.com"_s,
+};
+
+PacServer::PacServer(Config *config)
+    : HttpEndpoint(), config(config)
+{
+    route("/proxy.pac"_ba, [this](QByteArray &contentType)
+          { contentType = "application/x-ns-proxy-autoconfig"_ba;
+            return script(this->config); });
+}
+
+PacServer::~PacServer()
+{
+}
+
+QString PacServer::url(const Config *config)
+{
+    return u"http://127.0.0.1:%1/proxy.pac"_s.arg(config->pacPort);
+}
+
+QByteArray PacServer::script(const Config *config)
+{
+    // Clients on this machine reach a wildcard address through loopback
+    QString address = config->params[Param::Address].value<QString>();
+    const QHostAddress host(address);
+    if (host.isNull() || host == QHostAddress::AnyIPv4 || host == QHostAddress::AnyIPv6)
+    {
+        address = u"127.0.0.1"_s;
+    }
+    const QString port = config->ports().split(u':')[0];
+
+    QStringList hosts;
+    for (const QString &host : MusicHosts + config->pacHosts)
+    {
+        hosts << u"\"%1\""_s.arg(host);
+    }
+
+    return u"function FindProxyForURL(url, host) {\n"
+           "    var hosts = [%1];\n"
+           "    for (var i = 0; i < hosts.length; i++) {\n"
+           "        if (shExpMatch(host, hosts[i])) {\n"
+           "            return \"PROXY %2:%3\";\n"
+           "        }\n"
+           "    }\n"
+           "    return \"DIRECT\";\n"
+           "}\n"_s
+        .arg(hosts.join(u", "_s), address, port)
+        .toUtf8();
+}
+
+void PacServer::start()
+{
+    if (!config->pacProxy || isListening())
+    {
+        return;
+    }
+    // Only this machine's system proxy uses it
+    if (!listen(QHostAddress::LocalHost, config->pacPort))
+    {
+        emit out(tr("PAC server failed to listen on port %1: %2")
+                     .arg(config->pacPort)
+                     .arg(errorString()));
+    }
+}
+
+void PacServer::stop()
+{
+    close();
+}
+
+void PacServer::restart()
+{
+    stop();
+    start();
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "config/config.h"
+#include "httpendpoint.h"
+
+// Serves a proxy auto-config script sending only music hosts
+// through the server, so that other traffic goes direct
+class PacServer : public HttpEndpoint
+{
+    Q_OBJECT
+
+public:
+    PacServer(Config *config);
+    ~PacServer();
+
+    static QString url(const Config *config);
+    static QByteArray script(const Config *config);
+
+public slots:
+    void start();
+    void stop();
+    void restart();
+
+signals:
+    void out(const QString &message);
+
+private:
+    Config *config;
+};
@@ -0,0 +1,114 @@
+#include "profilesummary.h"
+
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLocale>
+
+#include <algorithm>
+#include <functional>
+
+using namespace Qt::StringLiterals;
+
+ProfileSummary::ProfileSummary() {}
+
+static QJsonObject readJson(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return {};
+    }
+    return QJsonDocument::fromJson(file.readAll()).object();
+}
+
+// Same function at the same place, whichever node it was sampled in
+static QString frameName(const QJsonObject &callFrame)
+{
+    QString name = callFrame[u"functionName"_s].toString();
+    if (name.isEmpty())
+    {
+        name = u"(anonymous)"_s;
+    }
+    const QString url = callFrame[u"url"_s].toString();
+    if (url.isEmpty())
+    {
+        return name;
+    }
+    // Line numbers are zero based
+    return u"%1 (%2:%3)"_s.arg(name, url.section(u'/', -1))
+        .arg(callFrame[u"lineNumber"_s].toInt() + 1);
+}
+
+// Largest entries first, with their share of the total
+static QStringList topEntries(const QHash<QString, double> &totals, const int &count,
+                              const std::function<QString(const double &)> &format)
+{
+    QList<std::pair<double, QString>> entries;
+    double sum = 0;
+    for (auto it = totals.cbegin(); it != totals.cend(); it++)
+    {
+        entries.append({it.value(), it.key()});
+        sum += it.value();
+    }
+    const qsizetype n = qMin(qsizetype(count), entries.size());
+    std::partial_sort(entries.begin(), entries.begin() + n, entries.end(),
+                      [](const auto &a, const auto &b)
+                      { return a.first > b.first; });
+
+    QStringList lines;
+    for (qsizetype i = 0; i < n && sum > 0; i++)
+    {
+        lines << u"%1%  %2  %3"_s.arg(entries[i].first / sum * 100, 5, 'f', 1)
+                     .arg(format(entries[i].first), 10)
+                     .arg(entries[i].second);
+    }
+    return lines;
+}
+
+// Self time per function from the samples and the time between them
+QStringList ProfileSummary::cpuProfile(const QString &fileName, const int &count)
+{
+    const QJsonObject profile = readJson(fileName);
+    QHash<int, QString> names;
+    for (const QJsonValue &node : profile[u"nodes"_s].toArray())
+    {
+        names.insert(node[u"id"_s].toInt(), frameName(node[u"callFrame"_s].toObject()));
+    }
+    const QJsonArray samples = profile[u"samples"_s].toArray();
+    const QJsonArray deltas = profile[u"timeDeltas"_s].toArray();
+
+    // Each delta is the time before its sample, so it belongs to the previous one
+    QHash<QString, double> selfTime;
+    for (qsizetype i = 0; i + 1 < samples.size() && i + 1 < deltas.size(); i++)
+    {
+        selfTime[names.value(samples[i].toInt())] += deltas[i + 1].toDouble();
+    }
+    return topEntries(selfTime, count, [](const double &micros)
+                      { return u"%1 ms"_s.arg(micros / 1000, 0, 'f', 1); });
+}
+
+// Sampled allocation size per function, summed over the call tree
+QStringList ProfileSummary::heapProfile(const QString &fileName, const int &count)
+{
+    const QJsonObject profile = readJson(fileName);
+    QHash<QString, double> selfSize;
+    QList<QJsonObject> pending = {profile[u"head"_s].toObject()};
+    while (!pending.isEmpty())
+    {
+        const QJsonObject node = pending.takeLast();
+        const double size = node[u"selfSize"_s].toDouble();
+        if (size > 0)
+        {
+            selfSize[frameName(node[u"callFrame"_s].toObject())] += size;
+        }
+        for (const QJsonValue &child : node[u"children"_s].toArray())
+        {
+            pending << child.toObject();
+        }
+    }
+    return topEntries(selfSize, count, [](const double &bytes)
+                      { return QLocale().formattedDataSize(qint64(bytes)); });
+}
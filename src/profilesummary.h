@@ -0,0 +1,14 @@
+#pragma once
+
+#include <QStringList>
+
+// Top functions of a Node.js profile, by self time or allocated size
+class ProfileSummary
+{
+public:
+    ProfileSummary();
+
+    // Lines of "percent, amount, function (file:line)"; empty when unreadable
+    static QStringList cpuProfile(const QString &fileName, const int &count);
+    static QStringList heapProfile(const QString &fileName, const int &count);
+};
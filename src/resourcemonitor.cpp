@@ -0,0 +1,143 @@
+#include "resourcemonitor.h"
+
+#include <QLocale>
+
+#ifdef Q_OS_WIN
+#include "utils/winutils.h"
+#elif defined(Q_OS_LINUX)
+#include "utils/linuxutils.h"
+#endif
+
+// Samples kept for the history
+static constexpr qsizetype HistorySize = 150;
+
+ResourceMonitor::ResourceMonitor(Config *config, QObject *parent)
+    : QObject(parent), config(config), timer(new QTimer(this)),
+      pid(0), lastCpuTime(0), lastTime(0),
+      samples(HistorySize), next(0), count(0),
+      memoryAlerted(false), growthAlerted(false)
+{
+    connect(timer, &QTimer::timeout, this, &ResourceMonitor::sample);
+}
+
+ResourceMonitor::~ResourceMonitor()
+{
+}
+
+void ResourceMonitor::start(const qint64 &pid)
+{
+    stop();
+    const ProcessStats stats = processStats(pid);
+    if (!stats.valid)
+    {
+        return;
+    }
+    this->pid = pid;
+    lastCpuTime = stats.cpuTime;
+    clock.start();
+    lastTime = 0;
+    next = 0;
+    count = 0;
+    peak = ResourceSample();
+    memoryAlerted = false;
+    growthAlerted = false;
+    timer->start(qMax(config->monitorInterval, 1) * 1000);
+}
+
+void ResourceMonitor::stop()
+{
+    timer->stop();
+    pid = 0;
+}
+
+ProcessStats ResourceMonitor::processStats(const qint64 &pid)
+{
+#ifdef Q_OS_WIN
+    return WinUtils::processStats(pid);
+#elif defined(Q_OS_LINUX)
+    return LinuxUtils::processStats(pid);
+#else
+    Q_UNUSED(pid);
+    return ProcessStats();
+#endif
+}
+
+void ResourceMonitor::sample()
+{
+    const ProcessStats stats = processStats(pid);
+    if (!stats.valid)
+    {
+        stop();
+        return;
+    }
+
+    const qint64 now = clock.elapsed();
+    ResourceSample current;
+    current.cpu = now > lastTime
+                      ? float(stats.cpuTime - lastCpuTime) * 100 / (now - lastTime)
+                      : 0;
+    current.rss = stats.rss;
+    current.fds = stats.fds;
+    lastCpuTime = stats.cpuTime;
+    lastTime = now;
+
+    samples[next] = current;
+    next = (next + 1) % HistorySize;
+    count = qMin(count + 1, HistorySize);
+
+    peak.cpu = qMax(peak.cpu, current.cpu);
+    peak.rss = qMax(peak.rss, current.rss);
+    peak.fds = qMax(peak.fds, current.fds);
+
+    emit sampled(current, peak);
+    checkAlerts(current);
+}
+
+void ResourceMonitor::checkAlerts(const ResourceSample &current)
+{
+    const QLocale locale;
+
+    // Alert once per crossing, and again after dropping back below
+    const qint64 limit = qint64(config->memoryAlert) * 1024 * 1024;
+    if (limit && current.rss > limit)
+    {
+        if (!memoryAlerted)
+        {
+            emit alert(tr("Server memory usage reached %1, above the %2 limit.")
+                           .arg(locale.formattedDataSize(current.rss),
+                                locale.formattedDataSize(limit)));
+        }
+        memoryAlerted = true;
+    }
+    else
+    {
+        memoryAlerted = false;
+    }
+
+    // Growth is measured against the smallest sample in the history
+    if (!config->memoryGrowthAlert || count < HistorySize / 4)
+    {
+        return;
+    }
+    qint64 lowest = current.rss;
+    for (qsizetype i = 0; i < count; i++)
+    {
+        lowest = qMin(lowest, samples[i].rss);
+    }
+    const qint64 growth = lowest ? (current.rss - lowest) * 100 / lowest : 0;
+    if (growth >= config->memoryGrowthAlert)
+    {
+        if (!growthAlerted)
+        {
+            emit alert(tr("Server memory grew by %1% to %2 within %3 minutes.")
+                           .arg(growth)
+                           .arg(locale.formattedDataSize(current.rss))
+                           .arg(qMax(count * qMax(config->monitorInterval, 1) / 60, qsizetype(1))));
+        }
+        growthAlerted = true;
+    }
+    else if (growth < config->memoryGrowthAlert / 2)
+    {
+        growthAlerted = false;
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "config/config.h"
+#include "utils/processstats.h"
+
+#include <QElapsedTimer>
+#include <QTimer>
+
+struct ResourceSample
+{
+    // CPU usage since the previous sample, 100 per busy core
+    float cpu = 0;
+    qint64 rss = 0;
+    int fds = 0;
+};
+
+// Samples CPU, memory and open files of a child process at a fixed interval
+class ResourceMonitor : public QObject
+{
+    Q_OBJECT
+
+public:
+    ResourceMonitor(Config *config, QObject *parent);
+    ~ResourceMonitor();
+
+    void start(const qint64 &pid);
+    void stop();
+
+    static ProcessStats processStats(const qint64 &pid);
+
+signals:
+    void sampled(const ResourceSample &sample, const ResourceSample &peak);
+    void alert(const QString &message);
+
+private:
+    Config *config;
+    QTimer *timer;
+    QElapsedTimer clock;
+    qint64 pid;
+    qint64 lastCpuTime;
+    qint64 lastTime;
+    QList<ResourceSample> samples;
+    qsizetype next;
+    qsizetype count;
+    ResourceSample peak;
+    bool memoryAlerted;
+    bool growthAlerted;
+
+    void sample();
+    void checkAlerts(const ResourceSample &current);
+};
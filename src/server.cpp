@@ -1,25 +1,167 @@
 #include "server.h"
+#include "metrics.h"
+#include "profilesummary.h"
+#include "trace.h"
 
+#include <QDateTime>
 #include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QLocale>
 #include <QMessageBox>
+#include <QTcpServer>
+#include <QTime>
+
+#include <algorithm>
 
 #ifdef Q_OS_WIN
 #include "utils/winutils.h"
+#elif defined(Q_OS_LINUX)
+#include "utils/linuxutils.h"
 #endif
 
 using namespace Qt::StringLiterals;
 
-Server::Server(Config *config)
-    : QProcess(), config(config)
+// Time between checks of the recycling policy
+static constexpr int RecycleInterval = 30 * 1000;
+// Time between checks while waiting for an idle moment
+static constexpr int RecyclePendingInterval = 1000;
+// Time without server output that counts as idle
+static constexpr qint64 IdleQuiet = 10 * 1000;
+// Time between checks for the end of streaming
+static constexpr int SchedulingInterval = 5 * 1000;
+// Time between checks for the profile after sampling ends
+static constexpr int ProfileInterval = 1000;
+// Checks before giving up on the profile
+static constexpr int ProfileChecks = 10;
+// Functions listed in a profile summary
+static constexpr int ProfileTop = 15;
+// Distance searched for a free port on either side
+static constexpr int PortSearch = 100;
+
+// Preloaded into node to sample it through the inspector, so that the
+// profile is written without stopping the server
+static constexpr char ProfileScript[] = R"(// Written by QtUnblockNeteaseMusic
+const fs = require('fs');
+const inspector = require('inspector');
+const file = process.env.UNM_PROFILE_FILE;
+const cpu = process.env.UNM_PROFILE_KIND === 'cpu';
+const session = new inspector.Session();
+session.connect();
+session.post(cpu ? 'Profiler.enable' : 'HeapProfiler.enable', () =>
+  session.post(cpu ? 'Profiler.start' : 'HeapProfiler.startSampling', () =>
+    setTimeout(() =>
+      session.post(cpu ? 'Profiler.stop' : 'HeapProfiler.stopSampling', (err, result) => {
+        if (!err) {
+          fs.writeFileSync(file + '.tmp', JSON.stringify(result.profile));
+          fs.renameSync(file + '.tmp', file);
+        }
+        session.disconnect();
+      }), Number(process.env.UNM_PROFILE_MS)).unref()));
+)";
+
+// Parse a CPU list such as "0-3,6"
+static QList<int> parseCpuList(const QString &list)
+{
+    QList<int> cpus;
+    for (const QString &range : list.split(u',', Qt::SkipEmptyParts))
+    {
+        const QStringList bounds = range.trimmed().split(u'-');
+        const int first = bounds[0].toInt();
+        const int last = bounds.size() > 1 ? bounds[1].toInt() : first;
+        for (int cpu = first; cpu <= last; cpu++)
+        {
+            cpus << cpu;
+        }
+    }
+    return cpus;
+}
+
+Server::Server(Config *config, const Role &role)
+    : QProcess(), config(config), role(role), backendPort(0), listenPort(0),
+      probe(new HealthProbe(config, this)),
+      monitor(new ResourceMonitor(config, this)),
+      warmUp(new WarmUp(config, this)),
+      telemetry(new NodeTelemetry(config, this)),
+      recycleTimer(new QTimer(this)), connections(0), rss(0), recycledRss(0),
+      schedulingTimer(new QTimer(this)), boosted(false),
+      profileTimer(new QTimer(this)), profileChecks(0), recoverSince(0), generation(0)
 {
+    qRegisterMetaType<ResourceSample>();
+
     connect(this, &Server::readyReadStandardOutput,
             [this]
-            { emit out(readAllStandardOutput()); });
+            { lastOutput.start();
+              updateScheduling();
+              emit output(readAllStandardOutput(), false, processId(), generation); });
     connect(this, &Server::readyReadStandardError,
             [this]
-            { emit err(readAllStandardError()); });
+            { lastOutput.start();
+              updateScheduling();
+              const QString text = readAllStandardError();
+              emit err(text);
+              emit output(text, true, processId(), generation); });
     connect(this, &Server::finished,
             this, &Server::on_finished);
+    connect(this, &Server::stateChanged, this, [this](ProcessState state)
+            { if (state == NotRunning)
+              {
+                  probe->stop();
+                  monitor->stop();
+                  warmUp->stop();
+                  telemetry->stop();
+                  recycleTimer->stop();
+                  schedulingTimer->stop();
+                  if (role == Primary)
+                  {
+                      Metrics::serverUptime.set(0);
+                  }
+                  if (role == Standby)
+                  {
+                      emit backendChanged(QString(), 0);
+                  }
+              } });
+
+    connect(probe, &HealthProbe::ready, this, &Server::ready);
+    connect(probe, &HealthProbe::ready, this, [this](const qint64 &elapsed)
+            { if (role == Primary)
+                  Metrics::serverReady.set(elapsed);
+              // A standby is only offered once it answers
+              if (role == Standby)
+                  emit backendChanged(backendHost(), backendPort);
+              const qint64 now = Trace::now();
+              if (recoverSince && role == Primary)
+              {
+                  const qint64 recovery = (now - recoverSince) / 1000000;
+                  Metrics::networkRecovery.set(recovery);
+                  emit out(tr("Recovered from the network change in %1 ms.").arg(recovery));
+              }
+              recoverSince = 0;
+              // Through the port clients use, the front proxy included
+              if (role == Primary && config->warmUp && config->warmUpSongs.size())
+              {
+                  emit out(tr("Warming up the server."));
+                  warmUp->start(backendHost(), clientPort());
+              }
+              else if (role == Primary)
+              {
+                  Metrics::warmUp.set(0);
+                  emit primed(false);
+              }
+              Trace::complete("server ready", "server", now - elapsed * 1000000, now); });
+    connect(probe, &HealthProbe::probed, this, &Server::probed);
+    connect(warmUp, &WarmUp::finished, this, [this](const qint64 &elapsed, const int &answered, const int &total)
+            { Metrics::warmUp.set(elapsed);
+              emit out(tr("Warm-up took %1 ms, %2 of %3 lookups answered.").arg(elapsed).arg(answered).arg(total));
+              emit primed(true); });
+    connect(probe, &HealthProbe::unhealthy, this, &Server::on_unhealthy);
+    connect(monitor, &ResourceMonitor::sampled, this, &Server::sampled);
+    connect(monitor, &ResourceMonitor::sampled, this, &Server::on_sampled);
+    connect(monitor, &ResourceMonitor::alert, this, &Server::alert);
+    connect(telemetry, &NodeTelemetry::sampled, this, &Server::on_nodeSampled);
+    connect(recycleTimer, &QTimer::timeout, this, &Server::checkRecycle);
+    connect(schedulingTimer, &QTimer::timeout, this, &Server::updateScheduling);
+    connect(profileTimer, &QTimer::timeout, this, &Server::checkProfile);
 }
 
 Server::~Server()
@@ -27,8 +169,41 @@ Server::~Server()
     close();
 }
 
+// Whether this server should run with the current settings
+bool Server::isWanted() const
+{
+    switch (role)
+    {
+    case Hedge:
+        return config->frontProxy && config->hedging;
+    case Standby:
+        return config->frontProxy && config->warmStandby &&
+               config->profiles.contains(config->standbyProfile);
+    default:
+        return true;
+    }
+}
+
 bool Server::findProgram()
 {
+    const TraceSpan span("Server::findProgram", "server");
+    // The hedge server may run another implementation
+    if (role == Hedge && config->hedgeServer.size())
+    {
+        const QFileInfo info(config->hedgeServer);
+        if (info.suffix() == u"js"_s)
+        {
+            program = u"node"_s;
+            arguments = {info.filePath()};
+        }
+        else
+        {
+            program = info.filePath();
+            arguments = {};
+        }
+        return info.exists();
+    }
+
     QDir appDir = QDir::current();
 
     QProcess node;
@@ -75,7 +250,10 @@ bool Server::findProgram()
 
 void Server::loadArgs()
 {
-    for (const Param &param : config->params)
+    const QList<Param> params = role == Standby
+                                    ? config->profileParams(config->standbyProfile)
+                                    : config->params;
+    for (const Param &param : params)
     {
         switch (param.typeId)
         {
@@ -92,9 +270,14 @@ void Server::loadArgs()
             }
             break;
         case QMetaType::QStringList:
-            if (param.value<QStringList>().size())
+            if (role == Hedge && param.name == config->params[Param::Sources].name &&
+                config->hedgeSources.size())
+            {
+                arguments << param.prefix << config->hedgeSources;
+            }
+            else if (param.value<QStringList>().size())
             {
-                arguments << param.prefix << param.value<QStringList>();
+                arguments << param.prefix << orderSources(param.value<QStringList>());
             }
             break;
         }
@@ -104,6 +287,28 @@ void Server::loadArgs()
         arguments << entry.split(u' ');
     }
 
+    // Leave the HTTP port to the front proxy and listen behind it
+    if (backendPort)
+    {
+        const QString &prefix = config->params[Param::Port].prefix;
+        const qsizetype i = arguments.indexOf(prefix);
+        if (i >= 0 && i < arguments.size() - 1)
+        {
+            QStringList ports = arguments[i + 1].split(u':');
+            ports[0] = QString::number(backendPort);
+            // The HTTPS port belongs to the primary server
+            if (role != Primary)
+            {
+                ports = ports.first(1);
+            }
+            arguments[i + 1] = ports.join(u':');
+        }
+        else
+        {
+            arguments << prefix << QString::number(backendPort);
+        }
+    }
+
     QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
     for (const QString &entry : config->env)
     {
@@ -117,27 +322,122 @@ void Server::loadArgs()
     {
         env.insert(u"LOG_LEVEL"_s, u"debug"_s);
     }
+    if (program == u"node"_s)
+    {
+        telemetry->addEnvironment(env);
+    }
     setProcessEnvironment(env);
 }
 
+// Everything the child is started with, to tell whether settings touch it
+QStringList Server::launchKey() const
+{
+    QStringList key = {program};
+    key << arguments << processEnvironment().toStringList()
+        << config->cpuAffinity << config->cgroup
+        << QString::number(config->niceness) << QString::number(config->schedPolicy)
+        << QString::number(config->ioClass) << QString::number(config->ioLevel)
+        << QString::number(config->cgroupMemory) << QString::number(config->cgroupCpu);
+    if (role == Hedge)
+    {
+        key << config->hedgeServer;
+    }
+    return key;
+}
+
+// Put the fastest reliable sources first in auto mode
+QStringList Server::orderSources(const QStringList &sources) const
+{
+    if (!config->autoSources || role == Hedge || sourceOrder.isEmpty())
+    {
+        return sources;
+    }
+    QStringList ordered = sources;
+    const auto rank = [this](const QString &source)
+    {
+        const qsizetype i = sourceOrder.indexOf(source.toLower());
+        return i < 0 ? sourceOrder.size() : i;
+    };
+    std::stable_sort(ordered.begin(), ordered.end(),
+                     [&rank](const QString &a, const QString &b)
+                     { return rank(a) < rank(b); });
+    return ordered;
+}
+
 void Server::start()
 {
     if (state() != NotRunning)
     {
         return;
     }
+    const TraceSpan span("Server::start", "server");
+    if (!isWanted())
+    {
+        emit backendChanged(QString(), 0);
+        return;
+    }
     if (findProgram())
     {
+        programArguments = arguments;
+        backendPort = config->frontProxy ? findBackendPort() : 0;
         loadArgs();
+        // Taken before port fallback and profiling, which reload() doesn't redo
+        const QStringList key = launchKey();
+        listenPort = config->params[Param::Port].value<QString>().split(u':')[0].toUShort();
+        if (role == Primary && !checkPorts())
+        {
+            emit out(tr("Server not started."));
+            emit backendChanged(backendHost(), backendPort);
+            return;
+        }
+        setupChild();
+        // Profiling applies to this start only
+        if (profileArgs.size() && program == u"node"_s)
+        {
+            arguments = profileArgs + arguments;
+            QProcessEnvironment env = processEnvironment();
+            env.insert(profileEnv);
+            setProcessEnvironment(env);
+        }
+        profileArgs.clear();
         if (config->debugInfo)
         {
             emit out(program + u' ' + arguments.join(u' '));
         }
+        const qint64 spawnTime = Trace::now();
         QProcess::start(program, arguments, QIODeviceBase::ReadOnly);
-        if (!waitForStarted())
+        const bool started = waitForStarted();
+        Trace::complete("spawn", "server", spawnTime, Trace::now());
+        if (!started)
         {
+            telemetry->stop();
             emit out(errorString());
         }
+        else
+        {
+            telemetry->started();
+            generation++;
+            launched = key;
+            probe->start(backendHost(), httpPort());
+            monitor->start(processId());
+            uptime.start();
+            lastOutput.start();
+            recyclePending.invalidate();
+            rss = 0;
+            recycleTimer->start(RecycleInterval);
+            if (role == Primary)
+            {
+                Metrics::serverUptime.start();
+            }
+            boosted = false;
+#ifdef Q_OS_WIN
+            applyScheduling(false);
+#endif
+        }
+        if (role != Standby)
+        {
+            emit backendChanged(backendHost(), backendPort);
+        }
     }
     else
     {
@@ -145,8 +445,467 @@ void Server::start()
     }
 }
 
+// Pick a free port for the server behind the front proxy
+quint16 Server::findBackendPort()
+{
+    QHostAddress address(config->params[Param::Address].value<QString>());
+    if (address.isNull())
+    {
+        address = QHostAddress::Any;
+    }
+    QTcpServer probe;
+    if (!probe.listen(address, 0))
+    {
+        emit out(tr("No free port for the front proxy: %1").arg(probe.errorString()));
+        return 0;
+    }
+    return probe.serverPort();
+}
+
+// Check the server's ports before spending a boot on them, moving to the
+// nearest free ones when allowed. False if the server cannot start.
+bool Server::checkPorts()
+{
+    const QString &prefix = config->params[Param::Port].prefix;
+    const qsizetype index = arguments.indexOf(prefix);
+    if (index < 0 || index >= arguments.size() - 1)
+    {
+        return true;
+    }
+    QStringList ports = arguments[index + 1].split(u':');
+    QHostAddress address(config->params[Param::Address].value<QString>());
+    if (address.isNull())
+    {
+        address = QHostAddress::Any;
+    }
+
+    // Ports the app itself listens on, or is about to
+    QList<int> taken = {config->pacPort, config->metricsPort};
+    for (const QString &port : ports)
+    {
+        taken << port.toInt();
+    }
+
+    bool changed = false;
+    for (qsizetype i = 0; i < ports.size() && i < 2; i++)
+    {
+        const quint16 port = ports[i].toUShort();
+        // The port behind the front proxy was just found free
+        if (!port || (i == 0 && backendPort) || isPortFree(address, port))
+        {
+            continue;
+        }
+        emit out(tr("Port %1 is already in use by %2.").arg(port).arg(portOwner(port)));
+        if (!config->portFallback)
+        {
+            return false;
+        }
+
+        int free = 0;
+        for (int distance = 1; distance <= PortSearch && !free; distance++)
+        {
+            for (const int candidate : {port + distance, port - distance})
+            {
+                if (candidate > 0 && candidate <= 65535 && !taken.contains(candidate) &&
+                    isPortFree(address, candidate))
+                {
+                    free = candidate;
+                    break;
+                }
+            }
+        }
+        if (!free)
+        {
+            emit out(tr("No free port found near %1.").arg(port));
+            return false;
+        }
+        emit out(tr("Using port %1 instead.").arg(free));
+        ports[i] = QString::number(free);
+        taken << free;
+        changed = true;
+    }
+
+    if (changed)
+    {
+        arguments[index + 1] = ports.join(u':');
+        // Behind the front proxy, the configured HTTP port is the proxy's
+        QStringList configured = config->params[Param::Port].value<QString>().split(u':');
+        for (qsizetype i = backendPort ? 1 : 0; i < configured.size() && i < ports.size(); i++)
+        {
+            configured[i] = ports[i];
+        }
+        emit portsChanged(configured.join(u':'));
+    }
+    else
+    {
+        // The configured ports are free again
+        emit portsChanged(QString());
+    }
+    listenPort = ports[0].toUShort();
+    return true;
+}
+
+bool Server::isPortFree(const QHostAddress &address, const quint16 &port)
+{
+    QTcpServer probe;
+    return probe.listen(address, port);
+}
+
+QString Server::portOwner(const quint16 &port) const
+{
+#ifdef Q_OS_WIN
+    const qint64 pid = WinUtils::portOwner(port);
+    const QString name = pid ? WinUtils::processName(pid) : QString();
+#elif defined(Q_OS_LINUX)
+    const qint64 pid = LinuxUtils::portOwner(port);
+    const QString name = pid ? LinuxUtils::processName(pid) : QString();
+#else
+    const qint64 pid = 0;
+    const QString name;
+#endif
+    if (!pid)
+    {
+        return tr("another program");
+    }
+    return tr("%1 (PID %2)").arg(name.size() ? name : tr("unknown")).arg(pid);
+}
+
+QString Server::backendHost()
+{
+    const QHostAddress address(config->params[Param::Address].value<QString>());
+    if (address.isNull() || address == QHostAddress::AnyIPv4 || address == QHostAddress::AnyIPv6)
+    {
+        return u"127.0.0.1"_s;
+    }
+    return address.toString();
+}
+
+// Port the server itself listens on for HTTP
+quint16 Server::httpPort()
+{
+    return backendPort ? backendPort : listenPort;
+}
+
+// Port clients connect to, the front proxy's when it is on
+quint16 Server::clientPort()
+{
+    return backendPort ? config->params[Param::Port].value<QString>().split(u':')[0].toUShort()
+                       : listenPort;
+}
+
+void Server::on_unhealthy(const int &failures)
+{
+    emit out(tr("Server did not respond properly to %1 health checks, restarting.")
+                 .arg(failures));
+    restart();
+}
+
+void Server::setConnections(const int &count)
+{
+    connections = count;
+    updateScheduling();
+}
+
+void Server::setSourceOrder(const QStringList &order)
+{
+    const QStringList sources = config->params[Param::Sources].value<QStringList>();
+    const QStringList before = orderSources(sources);
+    sourceOrder = order;
+    const QStringList after = orderSources(sources);
+    if (before == after || state() != Running || recyclePending.isValid())
+    {
+        return;
+    }
+    // Apply the new order at the next idle moment
+    emit out(tr("Faster source order found: %1.").arg(after.join(u", "_s)));
+    recycleReason = tr("source order");
+    recyclePending.start();
+    recycleTimer->start(RecyclePendingInterval);
+}
+
+void Server::on_sampled(const ResourceSample &sample)
+{
+    rss = sample.rss;
+    if (role == Primary)
+    {
+        Metrics::serverRss.set(sample.rss);
+        Metrics::serverCpu.set(qRound64(sample.cpu * 1000));
+        Metrics::serverOpenFiles.set(sample.fds);
+    }
+    // First sample of the new process after a recycle
+    if (recycledRss)
+    {
+        emit out(tr("Server memory before recycling: %1, after: %2.")
+                     .arg(QLocale().formattedDataSize(recycledRss),
+                          QLocale().formattedDataSize(rss)));
+        recycledRss = 0;
+    }
+}
+
+void Server::on_nodeSampled(const NodeSample &sample)
+{
+    if (role == Primary)
+    {
+        Metrics::serverLoopLag.set(sample.lagP99);
+        Metrics::serverLoopLagMax.set(sample.lagMax);
+        Metrics::serverGcPauses.add(sample.gcCount);
+        Metrics::serverGcTime.add(sample.gcTime);
+        Metrics::serverHeapUsed.set(sample.heapUsed);
+        Metrics::serverHeapTotal.set(sample.heapTotal);
+        Metrics::serverHandles.set(sample.handles);
+    }
+    emit nodeSampled(sample);
+}
+
+// Restart the server when it grew too big, ran too long or reached
+// the quiet hour, preferably while nobody is using it
+void Server::checkRecycle()
+{
+    if (!recyclePending.isValid())
+    {
+        const qint64 limit = qint64(config->recycleMemory) * 1024 * 1024;
+        if (limit && rss > limit)
+        {
+            recycleReason = tr("memory usage above %1")
+                                .arg(QLocale().formattedDataSize(limit));
+        }
+        else if (config->recycleUptime &&
+                 uptime.hasExpired(qint64(config->recycleUptime) * 60 * 60 * 1000))
+        {
+            recycleReason = tr("uptime above %n hour(s)", nullptr, config->recycleUptime);
+        }
+        // Uptime keeps it from recycling twice within the hour
+        else if (config->recycleHour >= 0 &&
+                 QTime::currentTime().hour() == config->recycleHour &&
+                 uptime.hasExpired(60 * 60 * 1000))
+        {
+            recycleReason = tr("quiet hour");
+        }
+        else
+        {
+            return;
+        }
+        recyclePending.start();
+        recycleTimer->start(RecyclePendingInterval);
+    }
+
+    const bool overdue = recyclePending.hasExpired(qint64(config->recycleGrace) * 60 * 1000);
+    if (!isIdle() && !overdue)
+    {
+        return;
+    }
+    emit out(overdue ? tr("Recycling server (%1) after waiting for it to become idle.")
+                           .arg(recycleReason)
+                     : tr("Recycling server (%1).").arg(recycleReason));
+    recycledRss = rss;
+    restart();
+}
+
+bool Server::isIdle() const
+{
+    return !connections && lastOutput.hasExpired(IdleQuiet);
+}
+
+// Apply the configured scheduling to the child as it starts,
+// and hand it the telemetry pipe when it reports
+void Server::setupChild()
+{
+#ifdef Q_OS_LINUX
+    const int telemetryFd = processEnvironment().contains(u"UNM_TELEMETRY_FD"_s)
+                                ? telemetry->open()
+                                : -1;
+    QByteArray procsFile;
+    if (config->cgroup.size())
+    {
+        if (LinuxUtils::createCgroup(config->cgroup, qint64(config->cgroupMemory) * 1024 * 1024,
+                                     config->cgroupCpu))
+        {
+            procsFile = QFile::encodeName(QDir(config->cgroup).filePath(u"cgroup.procs"_s));
+        }
+        else
+        {
+            emit out(tr("Unable to set up cgroup %1.").arg(config->cgroup));
+        }
+    }
+    if (config->dynamicScheduling && config->schedPolicy == 2 &&
+        !LinuxUtils::canLeaveIdle(config->niceness))
+    {
+        emit out(tr("The server can't leave the idle class without a higher nice limit "
+                    "(RLIMIT_NICE) or CAP_SYS_NICE, so it stays idle while streaming. "
+                    "Choose the batch class to let streaming raise it."));
+    }
+    const QList<int> cpus = parseCpuList(config->cpuAffinity);
+    const int policy = config->schedPolicy;
+    const int nice = config->niceness;
+    const int ioClass = config->ioClass;
+    const int ioLevel = config->ioLevel;
+    // Runs in the child between fork and exec, so threads started
+    // by the server inherit everything
+    setChildProcessModifier([=]
+                            {
+                                if (procsFile.size())
+                                {
+                                    LinuxUtils::joinCgroup(procsFile.constData());
+                                }
+                                LinuxUtils::setAffinity(0, cpus);
+                                LinuxUtils::setScheduling(0, policy, nice);
+                                LinuxUtils::setIoPriority(0, ioClass, ioLevel);
+                                if (telemetryFd >= 0)
+                                {
+                                    LinuxUtils::inheritFd(telemetryFd, NodeTelemetry::ChildFd);
+                                } });
+#endif
+}
+
+// Run at normal priority while streaming, and as configured otherwise
+void Server::applyScheduling(const bool &boost)
+{
+    bool ok = true;
+#ifdef Q_OS_WIN
+    ok = WinUtils::setProcessScheduling(processId(), parseCpuList(config->cpuAffinity),
+                                        boost ? 0 : config->schedPolicy, config->niceness,
+                                        !boost && config->schedPolicy);
+#elif defined(Q_OS_LINUX)
+    // Leaving the idle class would fail, only I/O and the cgroup follow streaming
+    if (config->schedPolicy != 2 || LinuxUtils::canLeaveIdle(config->niceness))
+    {
+        ok = LinuxUtils::setScheduling(processId(), boost ? 0 : config->schedPolicy, config->niceness);
+    }
+    if (config->ioClass)
+    {
+        ok &= LinuxUtils::setIoPriority(processId(), boost ? 1 : config->ioClass,
+                                        boost ? qMin(config->ioLevel, 4) : config->ioLevel);
+    }
+    if (config->cgroup.size() && config->cgroupCpu)
+    {
+        ok &= LinuxUtils::setCgroupCpu(config->cgroup, boost ? 0 : config->cgroupCpu);
+    }
+#endif
+    if (!ok && config->debugInfo)
+    {
+        emit out(boost ? tr("Unable to raise server priority for streaming.")
+                       : tr("Unable to lower server priority."));
+    }
+}
+
+void Server::updateScheduling()
+{
+    if (!config->dynamicScheduling || state() != Running)
+    {
+        return;
+    }
+    const bool streaming = !isIdle();
+    if (streaming == boosted)
+    {
+        return;
+    }
+    boosted = streaming;
+    applyScheduling(boosted);
+    boosted ? schedulingTimer->start(SchedulingInterval)
+            : schedulingTimer->stop();
+}
+
+// Restart the script server with a preload that samples it for a while
+void Server::profile(const ProfileKind &kind, const int &seconds)
+{
+    if (program != u"node"_s || state() == NotRunning)
+    {
+        emit out(tr("Profiling needs the script server running on Node.js."));
+        return;
+    }
+    const QDir dir(QDir::current().filePath(
+        u"profiles/"_s + QDateTime::currentDateTime().toString(u"yyyyMMdd-HHmmss"_s)));
+    QFile script(dir.filePath(u"profile.js"_s));
+    if (!dir.mkpath(u"."_s) || !script.open(QIODevice::WriteOnly) ||
+        script.write(ProfileScript) < 0)
+    {
+        emit out(tr("Unable to prepare profiling in %1").arg(dir.path()));
+        return;
+    }
+    script.close();
+
+    const bool cpu = kind == CpuProfile;
+    profileFile = dir.filePath(cpu ? u"server.cpuprofile"_s : u"server.heapprofile"_s);
+    profileArgs = {u"--require"_s, script.fileName()};
+    profileEnv.clear();
+    profileEnv.insert(u"UNM_PROFILE_FILE"_s, profileFile);
+    profileEnv.insert(u"UNM_PROFILE_KIND"_s, cpu ? u"cpu"_s : u"heap"_s);
+    profileEnv.insert(u"UNM_PROFILE_MS"_s, QString::number(seconds * 1000));
+
+    emit out(tr("Profiling the server for %1 s into %2").arg(seconds).arg(dir.path()));
+    restart();
+    profileChecks = 0;
+    profileTimer->start(seconds * 1000 + ProfileInterval);
+}
+
+void Server::checkProfile()
+{
+    profileTimer->setInterval(ProfileInterval);
+    if (!QFile::exists(profileFile))
+    {
+        if (++profileChecks >= ProfileChecks || state() == NotRunning)
+        {
+            profileTimer->stop();
+            emit out(tr("No profile was written to %1").arg(profileFile));
+        }
+        return;
+    }
+    profileTimer->stop();
+
+    const bool cpu = profileFile.endsWith(u".cpuprofile"_s);
+    const QStringList lines = cpu ? ProfileSummary::cpuProfile(profileFile, ProfileTop)
+                                  : ProfileSummary::heapProfile(profileFile, ProfileTop);
+    emit out(cpu ? tr("Top functions by self time in %1:").arg(profileFile)
+                 : tr("Top functions by sampled allocations in %1:").arg(profileFile));
+    emit out(lines.size() ? lines.join(u'\n') : tr("The profile is empty or unreadable."));
+}
+
+// Apply changed settings, restarting only when the child would be started differently
+void Server::reload()
+{
+    if (state() != NotRunning && isWanted() && bool(backendPort) == config->frontProxy)
+    {
+        arguments = programArguments;
+        loadArgs();
+        if (launchKey() == launched)
+        {
+            qDebug("Server arguments unchanged");
+            return;
+        }
+    }
+    qDebug("---Restarting server---");
+    if (role == Primary)
+    {
+        emit out(tr("Settings changed, restarting the server."));
+    }
+    restart();
+}
+
+// Keep-alive connections and lookups of the old network would fail or
+// hang until they time out. The server has no signal to drop them, so
+// it is restarted.
+void Server::recover(const QString &reason, const qint64 &since)
+{
+    if (state() == NotRunning)
+    {
+        return;
+    }
+    if (role == Primary)
+    {
+        Metrics::networkChanges.add();
+        emit out(tr("Network changed (%1), restarting the server.").arg(reason));
+    }
+    recoverSince = since;
+    restart();
+}
+
 void Server::restart()
 {
+    const TraceSpan span("Server::restart", "server");
+    if (role == Primary)
+    {
+        Metrics::serverRestarts.add();
+    }
     disconnect(this, &Server::finished,
                this, &Server::on_finished);
     close();
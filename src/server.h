@@ -1,30 +1,117 @@
 #pragma once
 
 #include "config/config.h"
+#include "healthprobe.h"
+#include "nodetelemetry.h"
+#include "resourcemonitor.h"
+#include "warmup.h"
 
+#include <QElapsedTimer>
 #include <QProcess>
+#include <QTimer>
 
 class Server : public QProcess
 {
     Q_OBJECT
 
 public:
-    Server(Config *config);
+    enum Role
+    {
+        Primary,
+        // Second server racing slow lookups behind the front proxy
+        Hedge,
+        // Runs the next likely profile behind the front proxy,
+        // so that switching to it does not wait for a boot
+        Standby
+    };
+
+    enum ProfileKind
+    {
+        CpuProfile,
+        HeapProfile
+    };
+    Q_ENUM(ProfileKind)
+
+    Server(Config *config, const Role &role = Primary);
     ~Server();
 
     void start();
     void restart();
+    void reload();
+    void recover(const QString &reason, const qint64 &since);
+    void setConnections(const int &count);
+    void setSourceOrder(const QStringList &order);
+    void profile(const ProfileKind &kind, const int &seconds);
 
 signals:
     void out(const QString &message);
     void err(const QString &message);
+    // Everything the child writes, with the run it came from
+    void output(const QString &text, const bool &isError, const qint64 &pid, const int &generation);
+    void backendChanged(const QString &host, const quint16 &port);
+    void portsChanged(const QString &ports);
+    void ready(const qint64 &elapsed);
+    // Ready for clients, after the warm-up if there was one
+    void primed(const bool &warmedUp);
+    void probed(const qint64 &latency, const double &average, const qint64 &p95);
+    void sampled(const ResourceSample &sample, const ResourceSample &peak);
+    void nodeSampled(const NodeSample &sample);
+    void alert(const QString &message);
 
 private:
     Config *config;
+    Role role;
     QString program;
     QStringList arguments;
+    QStringList programArguments;
+    QStringList launched;
+    quint16 backendPort;
+    quint16 listenPort;
+    HealthProbe *probe;
+    ResourceMonitor *monitor;
+    WarmUp *warmUp;
+    NodeTelemetry *telemetry;
+    QTimer *recycleTimer;
+    QElapsedTimer uptime;
+    QElapsedTimer lastOutput;
+    QElapsedTimer recyclePending;
+    QString recycleReason;
+    int connections;
+    qint64 rss;
+    qint64 recycledRss;
+    QTimer *schedulingTimer;
+    bool boosted;
+    QStringList sourceOrder;
+    QStringList profileArgs;
+    QProcessEnvironment profileEnv;
+    QString profileFile;
+    QTimer *profileTimer;
+    int profileChecks;
+    // Trace::now() of the network change being recovered from
+    qint64 recoverSince;
+    // Successful starts so far
+    int generation;
 
+    bool isWanted() const;
     bool findProgram();
     void loadArgs();
+    QStringList launchKey() const;
+    QStringList orderSources(const QStringList &sources) const;
+    quint16 findBackendPort();
+    bool checkPorts();
+    QString portOwner(const quint16 &port) const;
+    static bool isPortFree(const QHostAddress &address, const quint16 &port);
+    QString backendHost();
+    quint16 httpPort();
+    quint16 clientPort();
+    void on_unhealthy(const int &failures);
+    void on_sampled(const ResourceSample &sample);
+    void on_nodeSampled(const NodeSample &sample);
+    void checkRecycle();
+    bool isIdle() const;
+    void setupChild();
+    void applyScheduling(const bool &boost);
+    void updateScheduling();
+    void checkProfile();
     void on_finished(int exitCode, QProcess::ExitStatus exitStatus);
 };
@@ -0,0 +1,157 @@
+#include "sourceranking.h"
+
+#include <algorithm>
+
+using namespace Qt::StringLiterals;
+
+// Time between evaluations of the ranking
+static constexpr int EvaluateInterval = 10 * 60 * 1000;
+// Older lookups weigh less, about the last 200 count
+static constexpr double Decay = 0.995;
+// Weight of a new latency sample
+static constexpr double Alpha = 0.1;
+// Matches needed before a source is ranked
+static constexpr double MinMatches = 3;
+// Lowest success rate used in scores, so that rare sources still end up last
+static constexpr double MinSuccess = 0.05;
+
+SourceRanking::SourceRanking(Config *config)
+    : QObject(), config(config),
+      store(u"sources.ini"_s, QSettings::IniFormat),
+      timer(new QTimer(this))
+{
+    load();
+    lastOrder = order();
+    connect(timer, &QTimer::timeout, this, &SourceRanking::evaluate);
+    timer->start(EvaluateInterval);
+}
+
+SourceRanking::~SourceRanking()
+{
+    save();
+}
+
+void SourceRanking::load()
+{
+    for (const QString &source : store.childGroups())
+    {
+        store.beginGroup(source);
+        Stats &entry = stats[source];
+        entry.lookups = store.value("lookups").value<double>();
+        entry.matches = store.value("matches").value<double>();
+        entry.latency = store.value("latency").value<double>();
+        store.endGroup();
+    }
+}
+
+void SourceRanking::save()
+{
+    store.clear();
+    for (auto it = stats.cbegin(); it != stats.cend(); ++it)
+    {
+        store.beginGroup(it.key());
+        store.setValue("lookups", it->lookups);
+        store.setValue("matches", it->matches);
+        store.setValue("latency", it->latency);
+        store.endGroup();
+    }
+    store.sync();
+}
+
+// Sources in the order the server tries them, as Server::orderSources()
+QStringList SourceRanking::serverOrder() const
+{
+    QStringList sources;
+    for (const QString &source : config->params[Param::Sources].value<QStringList>())
+    {
+        sources << source.toLower();
+    }
+    if (!config->autoSources || lastOrder.isEmpty())
+    {
+        return sources;
+    }
+    const auto rank = [this](const QString &source)
+    {
+        const qsizetype i = lastOrder.indexOf(source);
+        return i < 0 ? lastOrder.size() : i;
+    };
+    std::stable_sort(sources.begin(), sources.end(),
+                     [&rank](const QString &a, const QString &b)
+                     { return rank(a) < rank(b); });
+    return sources;
+}
+
+void SourceRanking::count(const QString &source)
+{
+    Stats &entry = stats[source];
+    entry.lookups = entry.lookups * Decay + 1;
+    entry.matches *= Decay;
+}
+
+// A failed lookup went through every source
+void SourceRanking::on_failed()
+{
+    const QStringList sources = serverOrder();
+    for (const QString &source : sources.isEmpty() ? stats.keys() : sources)
+    {
+        count(source);
+    }
+}
+
+// Only the sources up to the one that answered were tried, so the ones
+// ranked behind it keep their rates instead of decaying toward zero
+void SourceRanking::on_matched(const QString &source, const qint64 &latency)
+{
+    const QStringList sources = serverOrder();
+    const qsizetype last = sources.indexOf(source);
+    for (qsizetype i = 0; i < last; i++)
+    {
+        count(sources[i]);
+    }
+    count(source);
+
+    Stats &entry = stats[source];
+    entry.latency = entry.matches > 0 ? Alpha * latency + (1 - Alpha) * entry.latency
+                                      : latency;
+    entry.matches = qMin(entry.matches + 1, qMax(entry.lookups, 1.0));
+}
+
+QList<SourceRank> SourceRanking::ranking() const
+{
+    QList<SourceRank> list;
+    for (auto it = stats.cbegin(); it != stats.cend(); ++it)
+    {
+        const double success = it->lookups > 0 ? it->matches / it->lookups : 0;
+        const bool ranked = it->matches >= MinMatches;
+        list << SourceRank{it.key(), it->lookups, it->matches, it->latency,
+                           it->latency / qMax(success, MinSuccess), ranked};
+    }
+    std::sort(list.begin(), list.end(), [](const SourceRank &a, const SourceRank &b)
+              { return a.ranked != b.ranked ? a.ranked : a.score < b.score; });
+    return list;
+}
+
+// Ranked sources from fastest to slowest
+QStringList SourceRanking::order() const
+{
+    QStringList list;
+    for (const SourceRank &rank : ranking())
+    {
+        if (rank.ranked)
+        {
+            list << rank.source;
+        }
+    }
+    return list;
+}
+
+void SourceRanking::evaluate()
+{
+    save();
+    const QStringList current = order();
+    if (current != lastOrder)
+    {
+        lastOrder = current;
+        emit orderChanged(current);
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "config/config.h"
+
+#include <QHash>
+#include <QSettings>
+#include <QTimer>
+
+struct SourceRank
+{
+    QString source;
+    double lookups;
+    double matches;
+    double latency;
+    // Expected time to a match in milliseconds, lower is better
+    double score;
+    bool ranked;
+};
+
+// Per-source success rate and match latency kept across runs,
+// ranking sources by their expected time to a match
+class SourceRanking : public QObject
+{
+    Q_OBJECT
+
+public:
+    SourceRanking(Config *config);
+    ~SourceRanking();
+
+    QList<SourceRank> ranking() const;
+    QStringList order() const;
+
+public slots:
+    void on_failed();
+    void on_matched(const QString &source, const qint64 &latency);
+    void evaluate();
+
+signals:
+    void orderChanged(const QStringList &order);
+
+private:
+    struct Stats
+    {
+        double lookups = 0;
+        double matches = 0;
+        double latency = 0;
+    };
+
+    Config *config;
+    QSettings store;
+    QHash<QString, Stats> stats;
+    QTimer *timer;
+    QStringList lastOrder;
+
+    void load();
+    void save();
+    QStringList serverOrder() const;
+    void count(const QString &source);
+};
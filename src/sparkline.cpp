@@ -0,0 +1,96 @@
+#include "sparkline.h"
+
+#include <QPainter>
+#include <QPainterPath>
+
+#include <algorithm>
+
+Sparkline::Sparkline(QWidget *parent)
+    : Sparkline(60, parent)
+{
+}
+
+Sparkline::Sparkline(const qsizetype &capacity, QWidget *parent)
+    : QWidget(parent), capacity(capacity)
+{
+    setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
+}
+
+Sparkline::~Sparkline()
+{
+}
+
+void Sparkline::setCapacity(const qsizetype &capacity)
+{
+    this->capacity = qMax(capacity, qsizetype(1));
+    if (values.size() > this->capacity)
+    {
+        values = values.last(this->capacity);
+    }
+    updateGeometry();
+    update();
+}
+
+void Sparkline::add(const double &value)
+{
+    values << value;
+    if (values.size() > capacity)
+    {
+        values.removeFirst();
+    }
+    update();
+}
+
+void Sparkline::setValues(const QList<double> &values)
+{
+    this->values = values.size() > capacity ? values.last(capacity) : values;
+    update();
+}
+
+void Sparkline::clear()
+{
+    values.clear();
+    update();
+}
+
+QSize Sparkline::sizeHint() const
+{
+    return QSize(int(capacity) * 2, fontMetrics().height());
+}
+
+void Sparkline::paintEvent(QPaintEvent *)
+{
+    if (values.isEmpty())
+    {
+        return;
+    }
+
+    QPainter painter(this);
+    painter.setRenderHint(QPainter::Antialiasing);
+
+    const double top = qMax(*std::max_element(values.cbegin(), values.cend()), 1.0);
+    const double step = double(width() - 1) / qMax(capacity - 1, qsizetype(1));
+    const double x0 = width() - 1 - step * (values.size() - 1);
+    const double h = height() - 2;
+
+    QPainterPath path;
+    bool drawing = false;
+    for (qsizetype i = 0; i < values.size(); i++)
+    {
+        const double x = x0 + step * i;
+        if (values[i] < 0)
+        {
+            // Failures are marked across the full height
+            painter.setPen(QColor(Qt::red));
+            painter.drawLine(QPointF(x, 0), QPointF(x, height()));
+            drawing = false;
+            continue;
+        }
+        const QPointF point(x, 1 + h - values[i] / top * h);
+        drawing ? path.lineTo(point) : path.moveTo(point);
+        drawing = true;
+    }
+
+    painter.setPen(QPen(palette().color(QPalette::Highlight), 1.5));
+    painter.drawPath(path);
+}
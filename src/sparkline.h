@@ -0,0 +1,27 @@
+#pragma once
+
+#include <QWidget>
+
+// Small line chart of the latest values, negative values mark failures
+class Sparkline : public QWidget
+{
+    Q_OBJECT
+
+public:
+    Sparkline(QWidget *parent = nullptr);
+    Sparkline(const qsizetype &capacity, QWidget *parent = nullptr);
+    ~Sparkline();
+
+    void setCapacity(const qsizetype &capacity);
+    void add(const double &value);
+    void setValues(const QList<double> &values);
+    void clear();
+    QSize sizeHint() const override;
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+
+private:
+    qsizetype capacity;
+    QList<double> values;
+};
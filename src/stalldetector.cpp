@@ -0,0 +1,86 @@
+#include "stalldetector.h"
+#include "metrics.h"
+
+#include <QThread>
+
+#ifdef Q_OS_LINUX
+#include "utils/linuxutils.h"
+#endif
+
+// Heartbeat period, also the time between checks
+static constexpr int HeartbeatInterval = 100;
+// Longer gaps are most likely a suspended system
+static constexpr qint64 MaxStall = 10 * 60 * 1000;
+
+StallDetector::StallDetector(Config *config)
+    : QObject(), config(config),
+      heartbeatTimer(new QTimer), checkTimer(new QTimer(this)),
+      guiThread(QThread::currentThreadId()), heartbeat(0), lastBeat(0)
+{
+    clock.start();
+    connect(heartbeatTimer, &QTimer::timeout, heartbeatTimer, [this]
+            { heartbeat.store(clock.elapsed(), std::memory_order_relaxed); });
+    connect(checkTimer, &QTimer::timeout, this, &StallDetector::check);
+}
+
+StallDetector::~StallDetector()
+{
+    delete heartbeatTimer;
+}
+
+void StallDetector::start()
+{
+    if (config->stallThreshold <= 0)
+    {
+        return;
+    }
+    lastBeat = clock.elapsed();
+    heartbeat.store(lastBeat, std::memory_order_relaxed);
+    backtrace.clear();
+    QMetaObject::invokeMethod(heartbeatTimer, [this]
+                              { heartbeatTimer->start(HeartbeatInterval); });
+    checkTimer->start(HeartbeatInterval);
+}
+
+void StallDetector::stop()
+{
+    checkTimer->stop();
+    QMetaObject::invokeMethod(heartbeatTimer, &QTimer::stop);
+}
+
+void StallDetector::restart()
+{
+    stop();
+    start();
+}
+
+void StallDetector::check()
+{
+    const qint64 beat = heartbeat.load(std::memory_order_relaxed);
+    if (beat == lastBeat)
+    {
+        // Still stuck, look at where once it counts as a stall
+        const qint64 late = clock.elapsed() - beat - HeartbeatInterval;
+        if (backtrace.isEmpty() && late > config->stallThreshold)
+        {
+#ifdef Q_OS_LINUX
+            backtrace = LinuxUtils::threadBacktrace(guiThread);
+#endif
+            if (backtrace.isEmpty())
+            {
+                backtrace << tr("No backtrace available");
+            }
+        }
+        return;
+    }
+
+    const qint64 stall = beat - lastBeat - HeartbeatInterval;
+    lastBeat = beat;
+    if (stall > config->stallThreshold && stall < MaxStall)
+    {
+        Metrics::guiStalls.add();
+        Metrics::guiStallTime.add(stall);
+        emit stalled(stall, backtrace);
+    }
+    backtrace.clear();
+}
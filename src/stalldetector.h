@@ -0,0 +1,41 @@
+#pragma once
+
+#include "config/config.h"
+
+#include <QElapsedTimer>
+#include <QTimer>
+
+#include <atomic>
+
+// Watches the GUI event loop from another thread. A timer in the GUI
+// thread keeps a heartbeat; a gap longer than the threshold is reported
+// once the loop runs again, with a backtrace taken while it was stuck.
+class StallDetector : public QObject
+{
+    Q_OBJECT
+
+public:
+    StallDetector(Config *config);
+    ~StallDetector();
+
+public slots:
+    void start();
+    void stop();
+    void restart();
+
+signals:
+    void stalled(const qint64 &duration, const QStringList &backtrace);
+
+private:
+    Config *config;
+    // Lives in the GUI thread, unlike this object
+    QTimer *heartbeatTimer;
+    QTimer *checkTimer;
+    QElapsedTimer clock;
+    Qt::HANDLE guiThread;
+    std::atomic<qint64> heartbeat;
+    qint64 lastBeat;
+    QStringList backtrace;
+
+    void check();
+};
@@ -0,0 +1,227 @@
+#pragma once
+
+#include <QList>
+#include <QtAlgorithms>
+
+#include <algorithm>
+
+// Fixed size window over the latest latency samples
+class LatencyWindow
+{
+public:
+    LatencyWindow(const qsizetype &capacity = 256)
+        : samples(capacity, 0), next(0), count(0){};
+
+    ~LatencyWindow(){};
+
+    void add(const qint64 &value)
+    {
+        samples[next] = value;
+        next = (next + 1) % samples.size();
+        count = qMin(count + 1, samples.size());
+    }
+
+    qsizetype size() const
+    {
+        return count;
+    }
+
+    // Nearest-rank percentile, p in [0, 1]
+    qint64 percentile(const double &p) const
+    {
+        if (!count)
+        {
+            return 0;
+        }
+        QList<qint64> sorted = samples.first(count);
+        const qsizetype n = qBound(qsizetype(0), qsizetype(p * count), count - 1);
+        std::nth_element(sorted.begin(), sorted.begin() + n, sorted.end());
+        return sorted[n];
+    }
+
+    void clear()
+    {
+        next = 0;
+        count = 0;
+    }
+
+private:
+    QList<qint64> samples;
+    qsizetype next;
+    qsizetype count;
+};
+
+// Exponentially weighted moving average
+class Ewma
+{
+public:
+    Ewma(const double &alpha = 0.2)
+        : alpha(alpha), average(0), empty(true){};
+
+    ~Ewma(){};
+
+    void add(const double &value)
+    {
+        average = empty ? value : alpha * value + (1 - alpha) * average;
+        empty = false;
+    }
+
+    double value() const
+    {
+        return average;
+    }
+
+    void clear()
+    {
+        average = 0;
+        empty = true;
+    }
+
+private:
+    double alpha;
+    double average;
+    bool empty;
+};
+
+// Log-linear histogram of non-negative values, like HdrHistogram:
+// values are exact below 8 and within 12.5% above, in fixed memory
+class Histogram
+{
+public:
+    Histogram()
+        : counts(Buckets, 0), total(0){};
+
+    ~Histogram(){};
+
+    void add(const qint64 &value)
+    {
+        counts[index(value)]++;
+        total++;
+    }
+
+    void merge(const Histogram &other)
+    {
+        for (qsizetype i = 0; i < Buckets; i++)
+        {
+            counts[i] += other.counts[i];
+        }
+        total += other.total;
+    }
+
+    quint64 count() const
+    {
+        return total;
+    }
+
+    // Upper bound of the bucket holding the percentile, p in [0, 1]
+    qint64 percentile(const double &p) const
+    {
+        if (!total)
+        {
+            return 0;
+        }
+        const quint64 rank = qMax(quint64(1), quint64(p * total + 0.5));
+        quint64 seen = 0;
+        for (qsizetype i = 0; i < Buckets; i++)
+        {
+            seen += counts[i];
+            if (seen >= rank)
+            {
+                return upperBound(i);
+            }
+        }
+        return upperBound(Buckets - 1);
+    }
+
+    void clear()
+    {
+        counts.fill(0);
+        total = 0;
+    }
+
+private:
+    static constexpr int SubBits = 3;
+    static constexpr int SubBuckets = 1 << SubBits;
+    // Covers values up to about 2^21, 35 minutes in milliseconds
+    static constexpr qsizetype Buckets = SubBuckets * 19;
+
+    QList<quint64> counts;
+    quint64 total;
+
+    static qsizetype index(const qint64 &value)
+    {
+        if (value < SubBuckets)
+        {
+            return qMax(value, qint64(0));
+        }
+        const int shift = 63 - qCountLeadingZeroBits(quint64(value)) - SubBits;
+        const qsizetype i = SubBuckets * (shift + 1) + ((value >> shift) - SubBuckets);
+        return qMin(i, Buckets - 1);
+    }
+
+    static qint64 upperBound(const qsizetype &i)
+    {
+        if (i < SubBuckets)
+        {
+            return i;
+        }
+        const int shift = int(i / SubBuckets) - 1;
+        const qint64 sub = i % SubBuckets;
+        return ((SubBuckets + sub + 1) << shift) - 1;
+    }
+};
+
+// Per-second event counts over the latest seconds
+class RollingCounter
+{
+public:
+    RollingCounter(const qsizetype &seconds = 60)
+        : counts(seconds, 0), last(0){};
+
+    ~RollingCounter(){};
+
+    void add(const qint64 &second, const quint64 &n = 1)
+    {
+        advance(second);
+        counts[second % counts.size()] += n;
+    }
+
+    quint64 sum(const qint64 &second)
+    {
+        advance(second);
+        quint64 total = 0;
+        for (const quint64 &count : counts)
+        {
+            total += count;
+        }
+        return total;
+    }
+
+    // Counts from oldest to newest, the current second last
+    QList<double> values(const qint64 &second)
+    {
+        advance(second);
+        QList<double> list;
+        list.reserve(counts.size());
+        for (qsizetype i = 1; i <= counts.size(); i++)
+        {
+            list << counts[(second + i) % counts.size()];
+        }
+        return list;
+    }
+
+private:
+    QList<quint64> counts;
+    qint64 last;
+
+    // Clear the slots of seconds passed without events
+    void advance(const qint64 &second)
+    {
+        const qint64 gap = qMin(second - last, qint64(counts.size()));
+        for (qint64 i = 1; i <= gap; i++)
+        {
+            counts[(last + i) % counts.size()] = 0;
+        }
+        last = qMax(last, second);
+    }
+};
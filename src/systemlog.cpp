@@ -0,0 +1,215 @@
+#include "systemlog.h"
+#include "metrics.h"
+
+#include <QCoreApplication>
+#include <QRegularExpression>
+#include <QtEndian>
+
+#ifdef Q_OS_LINUX
+#include "utils/linuxutils.h"
+#endif
+
+using namespace Qt::StringLiterals;
+
+// Time to gather messages before sending them together
+static constexpr int FlushDelay = 100;
+// Messages per send call
+static constexpr qsizetype BatchSize = 64;
+// Unsent messages kept while the log is busy, older ones are dropped
+static constexpr qsizetype MaxQueue = 4096;
+// Longer messages are cut, a datagram has to fit the socket buffer
+static constexpr qsizetype MaxMessage = 48 * 1024;
+// Syslog severities
+static constexpr int Warning = 4;
+static constexpr int Notice = 5;
+static constexpr int Info = 6;
+// Syslog facility of user programs, shifted into the priority
+static constexpr int UserFacility = 1 << 3;
+
+SystemLog::SystemLog(Config *config)
+    : QObject(), config(config), target(Off), fd(-1),
+      identifier(QCoreApplication::applicationName().toUtf8()),
+      flushTimer(new QTimer(this))
+{
+    flushTimer->setSingleShot(true);
+    flushTimer->setInterval(FlushDelay);
+    connect(flushTimer, &QTimer::timeout, this, &SystemLog::flush);
+}
+
+SystemLog::~SystemLog()
+{
+    stop();
+}
+
+void SystemLog::start()
+{
+    stop();
+#ifdef Q_OS_LINUX
+    if (config->systemLog == Off)
+    {
+        return;
+    }
+    target = config->systemLog;
+    const QByteArray path = target == Journal ? "/run/systemd/journal/socket"_ba : "/dev/log"_ba;
+    fd = LinuxUtils::openDatagram(path);
+    if (fd < 0)
+    {
+        target = Off;
+        emit out(tr("Unable to connect to the system log at %1").arg(QString::fromUtf8(path)));
+    }
+#endif
+}
+
+void SystemLog::stop()
+{
+    flush();
+    flushTimer->stop();
+    queue.clear();
+    partial.clear();
+#ifdef Q_OS_LINUX
+    if (fd >= 0)
+    {
+        LinuxUtils::closeFd(fd);
+    }
+#endif
+    fd = -1;
+    target = Off;
+}
+
+void SystemLog::reload()
+{
+    if (config->systemLog != target)
+    {
+        start();
+    }
+}
+
+// Output arrives in chunks, only whole lines are sent
+void SystemLog::on_output(const QString &source, const QString &text, const bool &isError,
+                          const qint64 &pid, const int &generation)
+{
+    if (fd < 0)
+    {
+        return;
+    }
+    static const QRegularExpression colors(u"\x1b\\[[0-9;]*m"_s);
+    QStringList lines = (partial.take(source) + text).split(u'\n');
+    const QString last = lines.takeLast();
+    if (last.size())
+    {
+        partial.insert(source, last);
+    }
+    for (QString &line : lines)
+    {
+        line.remove(colors);
+        if (line.trimmed().size())
+        {
+            add(isError ? Warning : Info, source, line.trimmed(), pid, generation);
+        }
+    }
+}
+
+void SystemLog::on_event(const QString &message)
+{
+    if (fd >= 0)
+    {
+        add(Notice, u"app"_s, message, 0, 0);
+    }
+}
+
+void SystemLog::add(const int &priority, const QString &source, const QString &message,
+                    const qint64 &pid, const int &generation)
+{
+    queue << (target == Journal ? journalEntry(priority, source, message, pid, generation)
+                                : syslogEntry(priority, source, message, pid, generation));
+    if (queue.size() > MaxQueue)
+    {
+        queue.removeFirst();
+        Metrics::systemLogDropped.add();
+    }
+    if (queue.size() >= BatchSize)
+    {
+        flush();
+    }
+    else if (!flushTimer->isActive())
+    {
+        flushTimer->start();
+    }
+}
+
+// Native journal protocol: one datagram of KEY=value lines, values with
+// newlines as KEY, a little endian 64 bit length and the raw value
+QByteArray SystemLog::journalEntry(const int &priority, const QString &source, const QString &message,
+                                   const qint64 &pid, const int &generation) const
+{
+    QByteArray entry;
+    const auto field = [&entry](const QByteArray &name, const QByteArray &value)
+    {
+        entry += name;
+        if (value.contains('\n'))
+        {
+            const quint64 size = qToLittleEndian(quint64(value.size()));
+            entry += '\n';
+            entry += QByteArrayView(reinterpret_cast<const char *>(&size), sizeof(size));
+            entry += value;
+        }
+        else
+        {
+            entry += '=';
+            entry += value;
+        }
+        entry += '\n';
+    };
+    field("PRIORITY"_ba, QByteArray::number(priority));
+    field("SYSLOG_IDENTIFIER"_ba, identifier);
+    const QByteArray text = message.toUtf8();
+    field("MESSAGE"_ba, text.first(qMin(text.size(), MaxMessage)));
+    field("UNM_SOURCE"_ba, source.toUtf8());
+    if (pid)
+    {
+        field("UNM_SERVER_PID"_ba, QByteArray::number(pid));
+        field("UNM_GENERATION"_ba, QByteArray::number(generation));
+    }
+    return entry;
+}
+
+// The local syslog format, with the fields leading the message
+QByteArray SystemLog::syslogEntry(const int &priority, const QString &source, const QString &message,
+                                  const qint64 &pid, const int &generation) const
+{
+    QByteArray entry = '<' + QByteArray::number(UserFacility | priority) + '>' + identifier +
+                       '[' + QByteArray::number(QCoreApplication::applicationPid()) + "]: [source="_ba +
+                       source.toUtf8();
+    if (pid)
+    {
+        entry += " pid="_ba + QByteArray::number(pid) + " generation="_ba + QByteArray::number(generation);
+    }
+    entry += "] "_ba + message.toUtf8();
+    return entry.first(qMin(entry.size(), MaxMessage));
+}
+
+void SystemLog::flush()
+{
+#ifdef Q_OS_LINUX
+    while (fd >= 0 && queue.size())
+    {
+        const int sent = LinuxUtils::sendBatch(fd, queue.first(qMin(queue.size(), BatchSize)));
+        if (sent < 0)
+        {
+            // Reconnect, the journal may have been restarted
+            Metrics::systemLogDropped.add(queue.size());
+            queue.clear();
+            start();
+            return;
+        }
+        if (sent == 0)
+        {
+            // Full, try again later rather than wait
+            flushTimer->start();
+            return;
+        }
+        queue.remove(0, sent);
+        Metrics::systemLogSent.add(sent);
+    }
+#endif
+}
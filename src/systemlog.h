@@ -0,0 +1,56 @@
+#pragma once
+
+#include "config/config.h"
+
+#include <QHash>
+#include <QTimer>
+
+// Forwards server output and app events to the systemd journal, over its
+// native protocol, or to syslog, with the source, server pid and restart
+// generation as fields. Runs in its own thread and sends in batches that
+// never wait, so a slow journal drops messages instead of backing up the
+// server's output.
+class SystemLog : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Target
+    {
+        Off,
+        Journal,
+        Syslog
+    };
+
+    SystemLog(Config *config);
+    ~SystemLog();
+
+signals:
+    void out(const QString &message);
+
+public slots:
+    void start();
+    void stop();
+    void reload();
+    void on_output(const QString &source, const QString &text, const bool &isError,
+                   const qint64 &pid, const int &generation);
+    void on_event(const QString &message);
+
+private:
+    Config *config;
+    int target;
+    int fd;
+    QByteArray identifier;
+    QTimer *flushTimer;
+    QList<QByteArray> queue;
+    // Unfinished last line of each source
+    QHash<QString, QString> partial;
+
+    void add(const int &priority, const QString &source, const QString &message,
+             const qint64 &pid, const int &generation);
+    QByteArray journalEntry(const int &priority, const QString &source, const QString &message,
+                            const qint64 &pid, const int &generation) const;
+    QByteArray syslogEntry(const int &priority, const QString &source, const QString &message,
+                           const qint64 &pid, const int &generation) const;
+    void flush();
+};
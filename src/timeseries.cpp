@@ -0,0 +1,228 @@
+#include "timeseries.h"
+#include "metrics.h"
+
+#include <QDateTime>
+
+#include <cstddef>
+#include <cstring>
+
+using namespace Qt::StringLiterals;
+
+static const QString FileName = u"history.bin"_s;
+static constexpr char Magic[8] = "UNMHIST";
+static constexpr quint32 Version = 1;
+// An hour of seconds, a week of minutes and a year of hours, about 700 KiB
+static constexpr quint32 Capacities[3] = {60 * 60, 7 * 24 * 60, 365 * 24};
+
+TimeSeries::TimeSeries(Config *config)
+    : QObject(), config(config), timer(new QTimer(this)),
+      file(FileName), header(), lastTime(0), lastRestarts(0), lastMatches(0), lastLatency(0)
+{
+    connect(timer, &QTimer::timeout, this, &TimeSeries::sample);
+}
+
+TimeSeries::~TimeSeries()
+{
+    file.close();
+}
+
+void TimeSeries::start()
+{
+    if (!config->history || timer->isActive() || !open())
+    {
+        return;
+    }
+    lastRestarts = Metrics::serverRestarts.value();
+    lastMatches = Metrics::matches.value();
+    lastLatency = Metrics::matchLatency.value();
+    lastTime = QDateTime::currentMSecsSinceEpoch();
+    timer->start(1000);
+}
+
+void TimeSeries::stop()
+{
+    timer->stop();
+    file.close();
+    minute = Accumulator();
+    hour = Accumulator();
+}
+
+void TimeSeries::restart()
+{
+    stop();
+    start();
+}
+
+// Open the file, starting over when its layout does not match
+bool TimeSeries::open()
+{
+    if (!file.open(QIODevice::ReadWrite))
+    {
+        qWarning() << "Unable to open" << FileName << file.errorString();
+        return false;
+    }
+    if (file.read(reinterpret_cast<char *>(&header), sizeof(header)) == sizeof(header) &&
+        isValid(header))
+    {
+        return true;
+    }
+
+    header = Header();
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = Version;
+    header.recordSize = sizeof(HistoryRecord);
+    for (int i = 0; i < 3; i++)
+    {
+        header.tiers[i].capacity = Capacities[i];
+    }
+    const qint64 size = offset(header, Hours, Capacities[Hours]);
+    if (!file.resize(0) || !file.resize(size) || !file.seek(0) ||
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header)) != sizeof(header))
+    {
+        qWarning() << "Unable to create" << FileName << file.errorString();
+        file.close();
+        return false;
+    }
+    return true;
+}
+
+void TimeSeries::sample()
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    const qint64 restarts = Metrics::serverRestarts.value();
+    const qint64 matches = Metrics::matches.value();
+    const qint64 latency = Metrics::matchLatency.value();
+
+    HistoryRecord record{};
+    record.time = now;
+    record.rss = Metrics::serverRss.value();
+    record.cpu = Metrics::serverCpu.value() / 1000.0f;
+    record.matches = quint32(matches - lastMatches);
+    record.latency = record.matches ? float(latency - lastLatency) / record.matches : 0;
+    record.restarts = quint32(restarts - lastRestarts);
+    lastRestarts = restarts;
+    lastMatches = matches;
+    lastLatency = latency;
+
+    // Close the minute and hour when the clock passes them
+    const qint64 previous = lastTime;
+    lastTime = now;
+    if (minute.samples && now / 60000 != previous / 60000)
+    {
+        const HistoryRecord total = result(minute, now);
+        append(Minutes, total);
+        accumulate(hour, total);
+        minute = Accumulator();
+    }
+    if (hour.samples && now / 3600000 != previous / 3600000)
+    {
+        append(Hours, result(hour, now));
+        hour = Accumulator();
+    }
+
+    append(Seconds, record);
+    accumulate(minute, record);
+}
+
+void TimeSeries::accumulate(Accumulator &total, const HistoryRecord &record)
+{
+    total.rss = qMax(total.rss, record.rss);
+    total.cpu += record.cpu;
+    total.latency += double(record.latency) * record.matches;
+    total.matches += record.matches;
+    total.restarts += record.restarts;
+    total.samples++;
+}
+
+HistoryRecord TimeSeries::result(const Accumulator &total, const qint64 &time)
+{
+    HistoryRecord record{};
+    record.time = time;
+    record.rss = total.rss;
+    record.cpu = total.samples ? float(total.cpu / total.samples) : 0;
+    record.latency = total.matches ? float(total.latency / total.matches) : 0;
+    record.matches = total.matches;
+    record.restarts = total.restarts;
+    return record;
+}
+
+void TimeSeries::append(const Tier &tier, const HistoryRecord &record)
+{
+    TierHeader &ring = header.tiers[tier];
+    // The record goes first, so that readers never count a missing one
+    if (!file.seek(offset(header, tier, ring.next)) ||
+        file.write(reinterpret_cast<const char *>(&record), sizeof(record)) != sizeof(record))
+    {
+        return;
+    }
+    ring.next = (ring.next + 1) % ring.capacity;
+    ring.count = qMin(ring.count + 1, ring.capacity);
+    const qint64 position = offsetof(Header, tiers) + tier * sizeof(TierHeader);
+    if (file.seek(position))
+    {
+        file.write(reinterpret_cast<const char *>(&ring), sizeof(ring));
+    }
+    if (tier != Seconds)
+    {
+        file.flush();
+    }
+}
+
+qint64 TimeSeries::offset(const Header &header, const Tier &tier, const quint32 &index)
+{
+    qint64 records = index;
+    for (int i = 0; i < tier; i++)
+    {
+        records += header.tiers[i].capacity;
+    }
+    return sizeof(Header) + records * sizeof(HistoryRecord);
+}
+
+bool TimeSeries::isValid(const Header &header)
+{
+    if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 ||
+        header.version != Version || header.recordSize != sizeof(HistoryRecord))
+    {
+        return false;
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        const TierHeader &ring = header.tiers[i];
+        if (ring.capacity != Capacities[i] || ring.next >= ring.capacity || ring.count > ring.capacity)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Records of a tier from oldest to newest, read through a mapping
+QList<HistoryRecord> TimeSeries::read(const Tier &tier)
+{
+    QFile file(FileName);
+    if (!file.open(QIODevice::ReadOnly) || file.size() < qint64(sizeof(Header)))
+    {
+        return {};
+    }
+    const uchar *data = file.map(0, file.size());
+    if (!data)
+    {
+        return {};
+    }
+
+    QList<HistoryRecord> records;
+    Header header;
+    std::memcpy(&header, data, sizeof(header));
+    if (isValid(header) && file.size() >= offset(header, Hours, Capacities[Hours]))
+    {
+        const TierHeader &ring = header.tiers[tier];
+        records.resize(ring.count);
+        for (quint32 i = 0; i < ring.count; i++)
+        {
+            const quint32 index = (ring.next + ring.capacity - ring.count + i) % ring.capacity;
+            std::memcpy(&records[i], data + offset(header, tier, index), sizeof(HistoryRecord));
+        }
+    }
+    file.unmap(const_cast<uchar *>(data));
+    return records;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "config/config.h"
+
+#include <QFile>
+#include <QTimer>
+
+struct HistoryRecord
+{
+    // End of the period, in milliseconds since the epoch
+    qint64 time;
+    // Peak resident memory of the server
+    qint64 rss;
+    // Average CPU usage, 100 per busy core
+    float cpu;
+    // Average time from lookup to match, in milliseconds
+    float latency;
+    quint32 matches;
+    quint32 restarts;
+};
+static_assert(sizeof(HistoryRecord) == 32);
+
+// Long-term history of the server in a fixed size binary file.
+// Each tier is a ring of fixed records, appended to every second,
+// minute and hour; a full ring overwrites its oldest records.
+class TimeSeries : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Tier
+    {
+        Seconds,
+        Minutes,
+        Hours
+    };
+
+    TimeSeries(Config *config);
+    ~TimeSeries();
+
+    static QList<HistoryRecord> read(const Tier &tier);
+
+public slots:
+    void start();
+    void stop();
+    void restart();
+
+private:
+    struct TierHeader
+    {
+        quint32 capacity;
+        quint32 next;
+        quint32 count;
+        quint32 reserved;
+    };
+
+    struct Header
+    {
+        char magic[8];
+        quint32 version;
+        quint32 recordSize;
+        TierHeader tiers[3];
+    };
+
+    struct Accumulator
+    {
+        qint64 rss = 0;
+        double cpu = 0;
+        double latency = 0;
+        quint32 matches = 0;
+        quint32 restarts = 0;
+        int samples = 0;
+    };
+
+    Config *config;
+    QTimer *timer;
+    QFile file;
+    Header header;
+    Accumulator minute;
+    Accumulator hour;
+    qint64 lastTime;
+    qint64 lastRestarts;
+    qint64 lastMatches;
+    qint64 lastLatency;
+
+    bool open();
+    void sample();
+    void append(const Tier &tier, const HistoryRecord &record);
+    static void accumulate(Accumulator &total, const HistoryRecord &record);
+    static HistoryRecord result(const Accumulator &total, const qint64 &time);
+    static qint64 offset(const Header &header, const Tier &tier, const quint32 &index);
+    static bool isValid(const Header &header);
+};
@@ -0,0 +1,146 @@
+#include "trace.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QThread>
+
+#include <chrono>
+#include <cstring>
+
+using namespace Qt::StringLiterals;
+
+// Events kept per thread, later ones are dropped
+static constexpr int BufferSize = 8192;
+
+// Only its own thread writes a buffer, and count publishes the events
+struct Trace::Buffer
+{
+    Event events[BufferSize];
+    std::atomic<int> count{0};
+    std::atomic<quint64> dropped{0};
+    int tid = 0;
+    char name[32] = {};
+    Buffer *next = nullptr;
+};
+
+std::atomic<bool> Trace::enabled{false};
+std::atomic<Trace::Buffer *> Trace::buffers{nullptr};
+std::atomic<int> Trace::threads{0};
+
+void Trace::enable()
+{
+    enabled.store(true, std::memory_order_relaxed);
+}
+
+qint64 Trace::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+void Trace::complete(const char *name, const char *category, const qint64 &start, const qint64 &end)
+{
+    if (isEnabled())
+    {
+        record({name, category, start, end - start, 'X'});
+    }
+}
+
+void Trace::instant(const char *name, const char *category)
+{
+    if (isEnabled())
+    {
+        record({name, category, now(), 0, 'i'});
+    }
+}
+
+void Trace::record(const Event &event)
+{
+    Buffer *local = buffer();
+    const int i = local->count.load(std::memory_order_relaxed);
+    if (i >= BufferSize)
+    {
+        local->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    local->events[i] = event;
+    local->count.store(i + 1, std::memory_order_release);
+}
+
+// Buffer of the calling thread, registered on first use
+Trace::Buffer *Trace::buffer()
+{
+    thread_local Buffer *local = nullptr;
+    if (local)
+    {
+        return local;
+    }
+    local = new Buffer;
+    local->tid = threads.fetch_add(1, std::memory_order_relaxed) + 1;
+    QByteArray name = QThread::currentThread()->objectName().toUtf8();
+    if (name.isEmpty())
+    {
+        const QCoreApplication *app = QCoreApplication::instance();
+        name = app && app->thread() == QThread::currentThread()
+                   ? "main"_ba
+                   : "thread " + QByteArray::number(local->tid);
+    }
+    std::strncpy(local->name, name.constData(), sizeof(local->name) - 1);
+
+    Buffer *head = buffers.load(std::memory_order_relaxed);
+    do
+    {
+        local->next = head;
+    } while (!buffers.compare_exchange_weak(head, local, std::memory_order_release,
+                                            std::memory_order_relaxed));
+    return local;
+}
+
+// Write the events in Chrome trace event format, readable by Perfetto
+bool Trace::write(const QString &fileName)
+{
+    if (!isEnabled())
+    {
+        return false;
+    }
+    const QByteArray pid = QByteArray::number(QCoreApplication::applicationPid());
+    QByteArrayList events;
+    quint64 dropped = 0;
+    for (const Buffer *buffer = buffers.load(std::memory_order_acquire); buffer; buffer = buffer->next)
+    {
+        const QByteArray tid = QByteArray::number(buffer->tid);
+        events << R"({"name":"thread_name","ph":"M","pid":)" + pid + R"(,"tid":)" + tid +
+                      R"(,"args":{"name":")" + buffer->name + R"("}})";
+        const int count = buffer->count.load(std::memory_order_acquire);
+        for (int i = 0; i < count; i++)
+        {
+            const Event &event = buffer->events[i];
+            QByteArray line = R"({"name":")" + QByteArray(event.name) + R"(","cat":")" +
+                              event.category + R"(","ph":")" + event.phase +
+                              R"(","ts":)" + QByteArray::number(event.start / 1000.0, 'f', 3) +
+                              R"(,"pid":)" + pid + R"(,"tid":)" + tid;
+            line += event.phase == 'X'
+                        ? QByteArray(R"(,"dur":)" + QByteArray::number(event.duration / 1000.0, 'f', 3) + '}')
+                        : R"(,"s":"t"})"_ba;
+            events << line;
+        }
+        dropped += buffer->dropped.load(std::memory_order_relaxed);
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        qWarning() << "Unable to write trace" << fileName << file.errorString();
+        return false;
+    }
+    file.write(R"({"displayTimeUnit":"ms","traceEvents":[)" "\n");
+    file.write(events.join(",\n"_ba));
+    file.write("\n]}\n");
+    if (dropped)
+    {
+        qWarning() << "Trace buffers were full," << dropped << "events dropped";
+    }
+    return true;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <QString>
+
+#include <atomic>
+
+// Chrome trace events, recorded into per-thread buffers when enabled.
+// Names and categories must be string literals, only pointers are kept.
+class Trace
+{
+public:
+    static void enable();
+
+    static bool isEnabled()
+    {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    // Monotonic time in nanoseconds
+    static qint64 now();
+
+    static void complete(const char *name, const char *category, const qint64 &start, const qint64 &end);
+    static void instant(const char *name, const char *category);
+    static bool write(const QString &fileName);
+
+private:
+    struct Event
+    {
+        const char *name;
+        const char *category;
+        qint64 start;
+        qint64 duration;
+        char phase;
+    };
+
+    struct Buffer;
+
+    static std::atomic<bool> enabled;
+    static std::atomic<Buffer *> buffers;
+    static std::atomic<int> threads;
+
+    static void record(const Event &event);
+    static Buffer *buffer();
+};
+
+// Records the time until it goes out of scope as a span
+class TraceSpan
+{
+public:
+    TraceSpan(const char *name, const char *category = "app")
+        : name(name), category(category),
+          start(Trace::isEnabled() ? Trace::now() : 0){};
+
+    ~TraceSpan()
+    {
+        if (start)
+        {
+            Trace::complete(name, category, start, Trace::now());
+        }
+    };
+
+private:
+    const char *name;
+    const char *category;
+    qint64 start;
+};
@@ -1,14 +1,16 @@
 #include "tray.h"
 
+#include <QLocale>
 #include <QMenu>
 
 using namespace Qt::StringLiterals;
 
-Tray::Tray(MainWindow *w)
-    : QSystemTrayIcon(w),
-      w(w)
+Tray::Tray(WindowHost *host, Config *config)
+    : QSystemTrayIcon(host),
+      host(host), config(config)
 {
     menu = new QMenu();
+    profiles = new QMenu();
     show = new QAction();
     proxy = new QAction();
     exit = new QAction();
@@ -17,9 +19,11 @@ Tray::Tray(MainWindow *w)
     proxy->setText(tr("System Proxy"));
     proxy->setCheckable(true);
     exit->setText(tr("Exit"));
+    profiles->setTitle(tr("Profiles"));
 
     menu->addAction(show);
     menu->addAction(proxy);
+    menu->addMenu(profiles);
     menu->addAction(exit);
 
     setContextMenu(menu);
@@ -30,6 +34,8 @@ Tray::Tray(MainWindow *w)
     connect(show, &QAction::triggered, this, &Tray::on_show);
     connect(proxy, &QAction::triggered, this, &Tray::on_proxy);
     connect(exit, &QAction::triggered, this, &Tray::on_exit);
+    connect(profiles, &QMenu::aboutToShow, this, &Tray::on_profilesShown);
+    on_profilesShown();
 }
 
 Tray::~Tray()
@@ -37,6 +43,7 @@ Tray::~Tray()
     show->~QAction();
     proxy->~QAction();
     exit->~QAction();
+    profiles->~QMenu();
     menu->~QMenu();
 }
 
@@ -45,34 +52,61 @@ void Tray::on_activated(ActivationReason reason)
     switch (reason)
     {
     case Context:
-        proxy->setChecked(w->isProxy());
+        proxy->setChecked(host->isProxy());
         break;
     case Trigger:
-        if (w->isVisible())
-        {
-            w->close();
-        }
-        else
-        {
-            w->show();
-        }
+        host->toggle();
         break;
     default:
         break;
     }
 }
 
+void Tray::on_sampled(const ResourceSample &sample, const ResourceSample &peak)
+{
+    const QLocale locale;
+    setToolTip(tr("QtUnblockNeteaseMusic\n"
+                  "CPU: %1% (peak %2%)\n"
+                  "Memory: %3 (peak %4)")
+                   .arg(sample.cpu, 0, 'f', 1)
+                   .arg(peak.cpu, 0, 'f', 1)
+                   .arg(locale.formattedDataSize(sample.rss),
+                        locale.formattedDataSize(peak.rss)));
+}
+
+void Tray::on_alert(const QString &message)
+{
+    showMessage(tr("Server resources"), message, QSystemTrayIcon::Warning);
+}
+
 void Tray::on_show()
 {
-    w->show();
+    host->show();
+}
+
+void Tray::on_profilesShown()
+{
+    profiles->clear();
+    for (const QString &name : config->profiles.keys())
+    {
+        QAction *action = profiles->addAction(name);
+        action->setCheckable(true);
+        action->setChecked(name == config->profile);
+        connect(action, &QAction::triggered, this, [this, name]
+                { host->switchProfile(name); });
+    }
+    if (profiles->isEmpty())
+    {
+        profiles->addAction(tr("Save one in the window's Profiles menu"))->setEnabled(false);
+    }
 }
 
 void Tray::on_proxy(const bool &checked)
 {
-    w->setProxy(checked);
+    host->setProxy(checked);
 }
 
 void Tray::on_exit()
 {
-    w->exit();
+    host->exit();
 }
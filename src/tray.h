@@ -1,6 +1,6 @@
 #pragma once
 
-#include "mainwindow.h"
+#include "windowhost.h"
 
 #include <QSystemTrayIcon>
 
@@ -9,19 +9,26 @@ class Tray : public QSystemTrayIcon
     Q_OBJECT
 
 public:
-    Tray(MainWindow *w);
+    Tray(WindowHost *host, Config *config);
     ~Tray();
     QAction *show;
     QAction *exit;
     QAction *proxy;
 
 private:
-    MainWindow *w;
+    WindowHost *host;
+    Config *config;
     QMenu *menu;
+    QMenu *profiles;
+
+public slots:
+    void on_sampled(const ResourceSample &sample, const ResourceSample &peak);
+    void on_alert(const QString &message);
 
 private slots:
     void on_activated(ActivationReason reason);
     void on_show();
+    void on_profilesShown();
     void on_proxy(const bool &checked);
     void on_exit();
 };
@@ -0,0 +1,492 @@
+#include "linuxutils.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include <QDeadlineTimer>
+#include <QThread>
+#include <QVarLengthArray>
+
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <execinfo.h>
+#include <fcntl.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace Qt::StringLiterals;
+
+// Policies in the order of the settings
+static constexpr int Policies[] = {SCHED_OTHER, SCHED_BATCH, SCHED_IDLE};
+// I/O classes in the order of the settings, none keeps the default
+static constexpr int IoClasses[] = {0, 2, 3};
+static constexpr int IoClassShift = 13;
+static constexpr int IoWhoProcess = 1;
+// Period for cgroup CPU quotas, in microseconds
+static constexpr int CpuPeriod = 100000;
+// Frames kept from another thread's backtrace
+static constexpr int BacktraceFrames = 64;
+// Time to wait for the signalled thread to record its frames
+static constexpr int BacktraceTimeout = 200;
+
+static void *backtraceFrames[BacktraceFrames];
+static std::atomic<int> backtraceDepth{-1};
+
+// Runs in the signalled thread
+static void backtraceHandler(int)
+{
+    backtraceDepth.store(backtrace(backtraceFrames, BacktraceFrames), std::memory_order_release);
+}
+
+LinuxUtils::LinuxUtils() {}
+
+// Read resource usage from /proc
+ProcessStats LinuxUtils::processStats(const qint64 &pid)
+{
+    ProcessStats stats;
+    const QString procDir = u"/proc/%1/"_s.arg(pid);
+
+    QFile statFile(procDir + u"stat"_s);
+    if (!statFile.open(QIODevice::ReadOnly))
+    {
+        return stats;
+    }
+    // The command name may contain spaces, so fields are counted from its end
+    const QByteArray stat = statFile.readAll();
+    const QList<QByteArray> fields = stat.sliced(stat.lastIndexOf(')') + 2).split(' ');
+    if (fields.size() < 13)
+    {
+        return stats;
+    }
+    // utime and stime, fields 14 and 15 of the whole line
+    static const long ticks = sysconf(_SC_CLK_TCK);
+    stats.cpuTime = (fields[11].toLongLong() + fields[12].toLongLong()) * 1000 / ticks;
+
+    QFile statusFile(procDir + u"status"_s);
+    if (statusFile.open(QIODevice::ReadOnly))
+    {
+        while (!statusFile.atEnd())
+        {
+            const QByteArray line = statusFile.readLine();
+            if (line.startsWith("VmRSS:"))
+            {
+                stats.rss = line.sliced(6).trimmed().split(' ')[0].toLongLong() * 1024;
+                break;
+            }
+        }
+    }
+
+    stats.fds = QDir(procDir + u"fd"_s).entryList(QDir::AllEntries | QDir::System | QDir::NoDotAndDotDot).size();
+
+    stats.valid = true;
+    return stats;
+}
+
+// Process listening on a TCP port, 0 if none or not visible to this user
+qint64 LinuxUtils::portOwner(const quint16 &port)
+{
+    // Socket inode of the listener, from the kernel's socket tables
+    QByteArray inode;
+    for (const QString &table : {u"/proc/net/tcp"_s, u"/proc/net/tcp6"_s})
+    {
+        QFile file(table);
+        if (!file.open(QIODevice::ReadOnly))
+        {
+            continue;
+        }
+        file.readLine();
+        while (inode.isEmpty() && !file.atEnd())
+        {
+            const QList<QByteArray> fields = file.readLine().simplified().split(' ');
+            // Listening sockets are in state 0A
+            if (fields.size() > 9 && fields[3] == "0A" &&
+                fields[1].sliced(fields[1].lastIndexOf(':') + 1).toUShort(nullptr, 16) == port)
+            {
+                inode = fields[9];
+            }
+        }
+    }
+    if (inode.isEmpty() || inode == "0")
+    {
+        return 0;
+    }
+
+    const QString target = u"socket:["_s + QString::fromLatin1(inode) + u']';
+    const QDir proc(u"/proc"_s);
+    for (const QString &entry : proc.entryList(QDir::Dirs | QDir::NoDotAndDotDot))
+    {
+        bool ok;
+        const qint64 pid = entry.toLongLong(&ok);
+        if (!ok)
+        {
+            continue;
+        }
+        const QDir fdDir(proc.filePath(entry + u"/fd"_s));
+        for (const QString &fd : fdDir.entryList(QDir::Files | QDir::System | QDir::NoDotAndDotDot))
+        {
+            // The target is not a path, so it comes back resolved against the directory
+            if (QFile::symLinkTarget(fdDir.filePath(fd)).endsWith(u'/' + target))
+            {
+                return pid;
+            }
+        }
+    }
+    return 0;
+}
+
+QString LinuxUtils::processName(const qint64 &pid)
+{
+    QFile file(u"/proc/%1/comm"_s.arg(pid));
+    return file.open(QIODevice::ReadOnly) ? QString::fromLocal8Bit(file.readAll().trimmed()) : QString();
+}
+
+// Threads of a process, scheduling attributes are set per thread
+QList<qint64> LinuxUtils::threads(const qint64 &pid)
+{
+    QList<qint64> list;
+    const QStringList entries = QDir(u"/proc/%1/task"_s.arg(pid)).entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QString &entry : entries)
+    {
+        list << entry.toLongLong();
+    }
+    return list;
+}
+
+bool LinuxUtils::setAffinity(const qint64 &pid, const QList<int> &cpus)
+{
+    if (cpus.isEmpty())
+    {
+        return true;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (const int &cpu : cpus)
+    {
+        if (cpu >= 0 && cpu < CPU_SETSIZE)
+        {
+            CPU_SET(cpu, &set);
+        }
+    }
+    if (!pid)
+    {
+        return sched_setaffinity(0, sizeof(set), &set) == 0;
+    }
+    bool ok = true;
+    for (const qint64 &tid : threads(pid))
+    {
+        ok &= sched_setaffinity(tid, sizeof(set), &set) == 0;
+    }
+    return ok;
+}
+
+bool LinuxUtils::setScheduling(const qint64 &pid, const int &policy, const int &nice)
+{
+    const sched_param param{0};
+    const int native = Policies[qBound(0, policy, 2)];
+    if (!pid)
+    {
+        return sched_setscheduler(0, native, &param) == 0 &&
+               setpriority(PRIO_PROCESS, 0, nice) == 0;
+    }
+    bool ok = true;
+    for (const qint64 &tid : threads(pid))
+    {
+        ok &= sched_setscheduler(tid, native, &param) == 0;
+        // Leaving the nice value alone avoids needing privileges to raise it
+        if (getpriority(PRIO_PROCESS, tid) != nice)
+        {
+            ok &= setpriority(PRIO_PROCESS, tid, nice) == 0;
+        }
+    }
+    return ok;
+}
+
+// The kernel only lets a thread leave SCHED_IDLE if its nice limit would
+// allow the nice value, see can_nice(); the child inherits our limits
+bool LinuxUtils::canLeaveIdle(const int &nice)
+{
+    if (geteuid() == 0)
+    {
+        return true;
+    }
+    rlimit limit;
+    if (getrlimit(RLIMIT_NICE, &limit) != 0)
+    {
+        return false;
+    }
+    return limit.rlim_cur == RLIM_INFINITY || rlim_t(20 - qBound(-20, nice, 19)) <= limit.rlim_cur;
+}
+
+bool LinuxUtils::setIoPriority(const qint64 &pid, const int &ioClass, const int &level)
+{
+    const int native = IoClasses[qBound(0, ioClass, 2)];
+    if (!native)
+    {
+        return true;
+    }
+    const int priority = native << IoClassShift | qBound(0, level, 7);
+    if (!pid)
+    {
+        return syscall(SYS_ioprio_set, IoWhoProcess, 0, priority) == 0;
+    }
+    bool ok = true;
+    for (const qint64 &tid : threads(pid))
+    {
+        ok &= syscall(SYS_ioprio_set, IoWhoProcess, tid, priority) == 0;
+    }
+    return ok;
+}
+
+// Create a cgroup v2 group with limits.
+// The parent group must be delegated to the user.
+bool LinuxUtils::createCgroup(const QString &path, const qint64 &memoryMax, const int &cpuPercent)
+{
+    const QDir dir(path);
+    if (!dir.mkpath(u"."_s))
+    {
+        return false;
+    }
+    // Enabling controllers in the parent may already be done or not allowed
+    writeFile(QFileInfo(dir.absolutePath()).dir().filePath(u"cgroup.subtree_control"_s), "+cpu +memory");
+
+    const QByteArray memory = memoryMax ? QByteArray::number(memoryMax) : "max"_ba;
+    return writeFile(dir.filePath(u"memory.max"_s), memory) && setCgroupCpu(path, cpuPercent);
+}
+
+bool LinuxUtils::setCgroupCpu(const QString &path, const int &cpuPercent)
+{
+    const QByteArray quota = cpuPercent ? QByteArray::number(qint64(cpuPercent) * CpuPeriod / 100) : "max"_ba;
+    return writeFile(QDir(path).filePath(u"cpu.max"_s), quota + ' ' + QByteArray::number(CpuPeriod));
+}
+
+// Move the calling process into a cgroup, safe between fork and exec
+void LinuxUtils::joinCgroup(const char *procsFile)
+{
+    const int fd = open(procsFile, O_WRONLY | O_CLOEXEC);
+    if (fd >= 0)
+    {
+        // Writing 0 moves the writing process
+        [[maybe_unused]] const ssize_t written = write(fd, "0", 1);
+        close(fd);
+    }
+}
+
+// Backtrace of another thread of this process, taken by signalling it.
+// Only one caller at a time; symbols need the binary linked with -rdynamic.
+QStringList LinuxUtils::threadBacktrace(const Qt::HANDLE &thread)
+{
+    const int signo = SIGRTMIN + 4;
+    static const bool installed = [signo]
+    {
+        // The first call may load libgcc, which is not safe in a handler
+        void *frame;
+        backtrace(&frame, 1);
+        struct sigaction action = {};
+        action.sa_handler = backtraceHandler;
+        action.sa_flags = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        return sigaction(signo, &action, nullptr) == 0;
+    }();
+    if (!installed)
+    {
+        return {};
+    }
+
+    backtraceDepth.store(-1, std::memory_order_relaxed);
+    if (pthread_kill(pthread_t(thread), signo) != 0)
+    {
+        return {};
+    }
+    const QDeadlineTimer deadline(BacktraceTimeout);
+    int depth;
+    while ((depth = backtraceDepth.load(std::memory_order_acquire)) < 0)
+    {
+        if (deadline.hasExpired())
+        {
+            return {};
+        }
+        QThread::msleep(1);
+    }
+
+    QStringList lines;
+    char **symbols = backtrace_symbols(backtraceFrames, depth);
+    if (symbols)
+    {
+        // Skip the handler and the signal trampoline
+        for (int i = 2; i < depth; i++)
+        {
+            lines << QString::fromLocal8Bit(symbols[i]);
+        }
+        free(symbols);
+    }
+    return lines;
+}
+
+// Return freed heap pages to the system
+void LinuxUtils::releaseMemory()
+{
+#ifdef __GLIBC__
+    malloc_trim(0);
+#endif
+}
+
+bool LinuxUtils::createPipe(int &readFd, int &writeFd)
+{
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC | O_NONBLOCK) < 0)
+    {
+        return false;
+    }
+    readFd = fds[0];
+    writeFd = fds[1];
+    return true;
+}
+
+void LinuxUtils::inheritFd(const int &fd, const int &target)
+{
+    // dup2() clears close-on-exec on the copy, but not on the same fd
+    fd == target ? fcntl(fd, F_SETFD, 0) : dup2(fd, target);
+}
+
+// Append what is available, 0 at the end of the stream, -1 if nothing was
+qsizetype LinuxUtils::readFd(const int &fd, QByteArray &data)
+{
+    char buffer[4096];
+    qsizetype total = -1;
+    ssize_t size;
+    while ((size = read(fd, buffer, sizeof(buffer))) > 0)
+    {
+        data.append(buffer, size);
+        total = qMax(total, qsizetype(0)) + size;
+    }
+    return size == 0 && total < 0 ? 0 : total;
+}
+
+void LinuxUtils::closeFd(const int &fd)
+{
+    close(fd);
+}
+
+// A regular file and its directory, both owned by us and writable by no one else
+bool LinuxUtils::isPrivate(const QString &path)
+{
+    for (const QString &entry : {path, QFileInfo(path).absolutePath()})
+    {
+        struct stat info;
+        if (lstat(QFile::encodeName(entry).constData(), &info) != 0 || info.st_uid != geteuid() ||
+            (info.st_mode & (S_IWGRP | S_IWOTH)))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int LinuxUtils::openDatagram(const QByteArray &path)
+{
+    sockaddr_un address = {};
+    if (path.size() >= qsizetype(sizeof(address.sun_path)))
+    {
+        return -1;
+    }
+    const int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, path.constData(), path.size());
+    if (connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int LinuxUtils::sendBatch(const int &fd, const QList<QByteArray> &messages)
+{
+    QVarLengthArray<iovec, 64> vectors(messages.size());
+    QVarLengthArray<mmsghdr, 64> headers(messages.size());
+    for (qsizetype i = 0; i < messages.size(); i++)
+    {
+        vectors[i] = {const_cast<char *>(messages[i].constData()), size_t(messages[i].size())};
+        headers[i] = {};
+        headers[i].msg_hdr.msg_iov = &vectors[i];
+        headers[i].msg_hdr.msg_iovlen = 1;
+    }
+    const int sent = sendmmsg(fd, headers.data(), messages.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (sent < 0)
+    {
+        return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+    }
+    return sent;
+}
+
+// Non-blocking, -1 on failure
+int LinuxUtils::openNetlink()
+{
+    const int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    sockaddr_nl address = {};
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR;
+    if (bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Drain pending messages, true if any of them changed a link or an address
+bool LinuxUtils::readNetlink(const int &fd)
+{
+    alignas(nlmsghdr) char buffer[8192];
+    bool changed = false;
+    ssize_t size;
+    while ((size = recv(fd, buffer, sizeof(buffer), 0)) > 0)
+    {
+        int length = int(size);
+        for (const nlmsghdr *header = reinterpret_cast<const nlmsghdr *>(buffer);
+             NLMSG_OK(header, length); header = NLMSG_NEXT(header, length))
+        {
+            switch (header->nlmsg_type)
+            {
+            case RTM_NEWLINK:
+            case RTM_DELLINK:
+            case RTM_NEWADDR:
+            case RTM_DELADDR:
+                changed = true;
+                break;
+            default:
+                break;
+            }
+        }
+    }
+    // Messages were lost, anything may have changed
+    return changed || (size < 0 && errno == ENOBUFS);
+}
+
+bool LinuxUtils::writeFile(const QString &path, const QByteArray &data)
+{
+    QFile file(path);
+    return file.open(QIODevice::WriteOnly) && file.write(data) == data.size();
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "processstats.h"
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+class LinuxUtils
+{
+public:
+    LinuxUtils();
+
+    static ProcessStats processStats(const qint64 &pid);
+    static qint64 portOwner(const quint16 &port);
+    static QString processName(const qint64 &pid);
+
+    // A pid of 0 means the calling thread only, without allocating,
+    // so that these can run in a child between fork and exec
+    static bool setAffinity(const qint64 &pid, const QList<int> &cpus);
+    static bool setScheduling(const qint64 &pid, const int &policy, const int &nice);
+    static bool setIoPriority(const qint64 &pid, const int &ioClass, const int &level);
+    static bool canLeaveIdle(const int &nice);
+
+    static bool createCgroup(const QString &path, const qint64 &memoryMax, const int &cpuPercent);
+    static bool setCgroupCpu(const QString &path, const int &cpuPercent);
+    static void joinCgroup(const char *procsFile);
+
+    // Non-blocking pipe closed on exec, with inheritFd() to hand its write
+    // end to a child between fork and exec
+    static bool createPipe(int &readFd, int &writeFd);
+    static void inheritFd(const int &fd, const int &target);
+    static qsizetype readFd(const int &fd, QByteArray &data);
+    static void closeFd(const int &fd);
+    static bool isPrivate(const QString &path);
+
+    static QStringList threadBacktrace(const Qt::HANDLE &thread);
+    static void releaseMemory();
+
+    // Non-blocking datagram socket connected to a local path, -1 on failure
+    static int openDatagram(const QByteArray &path);
+    // Messages sent in one call without waiting, or -1 on a hard error
+    static int sendBatch(const int &fd, const QList<QByteArray> &messages);
+
+    // Route netlink socket reporting link and address changes
+    static int openNetlink();
+    static bool readNetlink(const int &fd);
+
+private:
+    static QList<qint64> threads(const qint64 &pid);
+    static bool writeFile(const QString &path, const QByteArray &data);
+};
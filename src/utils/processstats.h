@@ -0,0 +1,15 @@
+#pragma once
+
+#include <QtGlobal>
+
+// Resource usage of a process at one point in time
+struct ProcessStats
+{
+    bool valid = false;
+    // User and system CPU time in milliseconds
+    qint64 cpuTime = 0;
+    // Resident set size in bytes
+    qint64 rss = 0;
+    // Open file descriptors, or handles on Windows
+    int fds = 0;
+};
@@ -3,7 +3,12 @@
 #include <QFile>
 #include <QProcess>
 
+#include <QFileInfo>
+
+#include <WinSock2.h>
 #include <Windows.h>
+#include <iphlpapi.h>
+#include <Psapi.h>
 #include <ShlObj.h>
 #include <uxtheme.h>
 #include <wininet.h>
@@ -81,6 +86,55 @@ void WinUtils::setThrottle(const bool &enable)
         enable ? IDLE_PRIORITY_CLASS : NORMAL_PRIORITY_CLASS);
 }
 
+// Set affinity, priority and EcoQoS of another process.
+// Policies are in the order of the settings: normal, batch, idle.
+bool WinUtils::setProcessScheduling(const qint64 &pid, const QList<int> &cpus,
+                                    const int &policy, const int &nice, const bool &throttle)
+{
+    HANDLE hProcess = OpenProcess(PROCESS_SET_INFORMATION, FALSE, (DWORD)pid);
+    if (!hProcess)
+    {
+        return false;
+    }
+
+    bool ok = true;
+    if (cpus.size())
+    {
+        DWORD_PTR mask = 0;
+        for (const int &cpu : cpus)
+        {
+            if (cpu >= 0 && cpu < int(sizeof(DWORD_PTR) * 8))
+            {
+                mask |= DWORD_PTR(1) << cpu;
+            }
+        }
+        ok &= bool(SetProcessAffinityMask(hProcess, mask));
+    }
+
+    DWORD priority = NORMAL_PRIORITY_CLASS;
+    if (policy == 2 || nice >= 15)
+    {
+        priority = IDLE_PRIORITY_CLASS;
+    }
+    else if (policy == 1 || nice > 0)
+    {
+        priority = BELOW_NORMAL_PRIORITY_CLASS;
+    }
+    else if (nice < 0)
+    {
+        priority = ABOVE_NORMAL_PRIORITY_CLASS;
+    }
+    ok &= bool(SetPriorityClass(hProcess, priority));
+    ok &= bool(SetProcessInformation(
+        hProcess,
+        ProcessPowerThrottling,
+        throttle ? &Throttle : &Unthrottle,
+        sizeof(PROCESS_POWER_THROTTLING_STATE)));
+
+    CloseHandle(hProcess);
+    return ok;
+}
+
 // Set window frame according to theme
 void WinUtils::setWindowFrame(const WId &winId, const QStyle *style)
 {
@@ -177,6 +231,150 @@ bool WinUtils::isSystemProxy(const QString &address)
     return false;
 }
 
+// Enable or disable proxy auto-config from url
+bool WinUtils::setAutoProxy(const bool &enable, const QString &url)
+{
+    INTERNET_PER_CONN_OPTION_LISTW optionList;
+    INTERNET_PER_CONN_OPTIONW options[2];
+
+    optionList.dwSize = sizeof(optionList);
+    optionList.pszConnection = NULL;
+    optionList.dwOptionCount = 2;
+    optionList.pOptions = options;
+
+    options[0].dwOption = INTERNET_PER_CONN_FLAGS;
+    options[0].Value.dwValue = enable ? PROXY_TYPE_AUTO_PROXY_URL | PROXY_TYPE_DIRECT
+                                      : PROXY_TYPE_DIRECT;
+
+    WCHAR autoconfig_url[MAX_PATH];
+    const int length = url.toWCharArray(autoconfig_url);
+    autoconfig_url[length] = L'\0';
+    options[1].dwOption = INTERNET_PER_CONN_AUTOCONFIG_URL;
+    options[1].Value.pszValue = autoconfig_url;
+
+    if (InternetSetOptionW(NULL, INTERNET_OPTION_PER_CONNECTION_OPTION,
+                           &optionList, optionList.dwSize))
+    {
+        InternetSetOptionW(NULL, INTERNET_OPTION_SETTINGS_CHANGED, NULL, 0);
+        InternetSetOptionW(NULL, INTERNET_OPTION_REFRESH, NULL, 0);
+        return true;
+    }
+    qWarning("%s: Unable to set auto proxy.", __FUNCTION__);
+    return false;
+}
+
+bool WinUtils::isAutoProxy(const QString &url)
+{
+    INTERNET_PER_CONN_OPTION_LISTW optionList;
+    INTERNET_PER_CONN_OPTIONW options[2];
+
+    optionList.dwSize = sizeof(optionList);
+    optionList.pszConnection = NULL;
+    optionList.dwOptionCount = 2;
+    optionList.pOptions = options;
+
+    options[0].dwOption = INTERNET_PER_CONN_FLAGS;
+    options[1].dwOption = INTERNET_PER_CONN_AUTOCONFIG_URL;
+
+    if (InternetQueryOptionW(NULL, INTERNET_OPTION_PER_CONNECTION_OPTION,
+                             &optionList, &optionList.dwSize))
+    {
+        WCHAR autoconfig_url[MAX_PATH];
+        const int length = url.toWCharArray(autoconfig_url);
+        autoconfig_url[length] = L'\0';
+
+        const bool isAuto = options[0].Value.dwValue & PROXY_TYPE_AUTO_PROXY_URL &&
+                            options[1].Value.pszValue &&
+                            lstrcmpW(options[1].Value.pszValue, autoconfig_url) == 0;
+        GlobalFree(options[1].Value.pszValue);
+        return isAuto;
+    }
+    qWarning("%s: Unable to get auto proxy.", __FUNCTION__);
+    return false;
+}
+
+// Read resource usage of another process
+ProcessStats WinUtils::processStats(const qint64 &pid)
+{
+    ProcessStats stats;
+    HANDLE hProcess = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, (DWORD)pid);
+    if (!hProcess)
+    {
+        return stats;
+    }
+
+    FILETIME creation, exit, kernel, user;
+    PROCESS_MEMORY_COUNTERS memory;
+    DWORD handles = 0;
+    if (GetProcessTimes(hProcess, &creation, &exit, &kernel, &user) &&
+        GetProcessMemoryInfo(hProcess, &memory, sizeof(memory)) &&
+        GetProcessHandleCount(hProcess, &handles))
+    {
+        // FILETIME counts 100 ns intervals
+        const auto ticks = [](const FILETIME &time)
+        { return (qint64(time.dwHighDateTime) << 32) | time.dwLowDateTime; };
+        stats.cpuTime = (ticks(kernel) + ticks(user)) / 10000;
+        stats.rss = memory.WorkingSetSize;
+        stats.fds = handles;
+        stats.valid = true;
+    }
+    CloseHandle(hProcess);
+    return stats;
+}
+
+// Process listening on a TCP port, 0 if none
+qint64 WinUtils::portOwner(const quint16 &port)
+{
+    for (const ULONG family : {AF_INET, AF_INET6})
+    {
+        DWORD size = 0;
+        GetExtendedTcpTable(nullptr, &size, FALSE, family, TCP_TABLE_OWNER_PID_LISTENER, 0);
+        QByteArray buffer(size, 0);
+        if (GetExtendedTcpTable(buffer.data(), &size, FALSE, family,
+                                TCP_TABLE_OWNER_PID_LISTENER, 0) != NO_ERROR)
+        {
+            continue;
+        }
+        if (family == AF_INET)
+        {
+            const auto *table = reinterpret_cast<const MIB_TCPTABLE_OWNER_PID *>(buffer.constData());
+            for (DWORD i = 0; i < table->dwNumEntries; i++)
+            {
+                if (ntohs((u_short)table->table[i].dwLocalPort) == port)
+                {
+                    return table->table[i].dwOwningPid;
+                }
+            }
+        }
+        else
+        {
+            const auto *table = reinterpret_cast<const MIB_TCP6TABLE_OWNER_PID *>(buffer.constData());
+            for (DWORD i = 0; i < table->dwNumEntries; i++)
+            {
+                if (ntohs((u_short)table->table[i].dwLocalPort) == port)
+                {
+                    return table->table[i].dwOwningPid;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+QString WinUtils::processName(const qint64 &pid)
+{
+    HANDLE hProcess = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, (DWORD)pid);
+    if (!hProcess)
+    {
+        return QString();
+    }
+    wchar_t path[MAX_PATH];
+    DWORD size = MAX_PATH;
+    const bool ok = QueryFullProcessImageNameW(hProcess, 0, path, &size);
+    CloseHandle(hProcess);
+    return ok ? QFileInfo(QString::fromWCharArray(path, size)).fileName() : QString();
+}
+
 // Check if current user is administrator
 bool WinUtils::isAdmin()
 {
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "processstats.h"
+
 #include <QStyle>
 #include <QWindow>
 
@@ -10,9 +12,16 @@ public:
 
     static void setStartup(const bool &enable, const bool &silent);
     static void setThrottle(const bool &enable);
+    static bool setProcessScheduling(const qint64 &pid, const QList<int> &cpus,
+                                     const int &policy, const int &nice, const bool &throttle);
     static void setWindowFrame(const WId &winId, const QStyle *style);
     static bool setSystemProxy(const bool &enable, const QString &address);
     static bool isSystemProxy(const QString &address);
+    static bool setAutoProxy(const bool &enable, const QString &url);
+    static bool isAutoProxy(const QString &url);
+    static ProcessStats processStats(const qint64 &pid);
+    static qint64 portOwner(const quint16 &port);
+    static QString processName(const qint64 &pid);
     static bool isAdmin();
     static std::tuple<bool, QString, QString> installCA(const QString &caPath);
 
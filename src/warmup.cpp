@@ -0,0 +1,90 @@
+#include "warmup.h"
+
+#include <QTimer>
+
+using namespace Qt::StringLiterals;
+
+// Matching may try several sources in a row
+static constexpr int LookupTimeout = 20000;
+
+WarmUp::WarmUp(Config *config, QObject *parent)
+    : QObject(parent), config(config), answered(0), total(0)
+{
+}
+
+WarmUp::~WarmUp()
+{
+}
+
+void WarmUp::start(const QString &host, const quint16 &port)
+{
+    stop();
+    if (!port || config->warmUpSongs.isEmpty())
+    {
+        return;
+    }
+    timer.start();
+    total = config->warmUpSongs.size();
+
+    // The plain API takes its parameters unencrypted, the server hooks it
+    // like the client's own lookups
+    QByteArray head = "POST http://music.163.com/api/song/enhance/player/url HTTP/1.1\r\n"
+                      "Host: music.163.com\r\n"
+                      "Content-Type: application/x-www-form-urlencoded\r\n"
+                      "Connection: close\r\n"_ba;
+    const QString token = config->params[Param::Token].value<QString>();
+    if (token.size())
+    {
+        head += "Proxy-Authorization: Basic " + token.toUtf8().toBase64() + "\r\n";
+    }
+
+    for (const QString &song : config->warmUpSongs)
+    {
+        const QByteArray body = "ids=%5B" + song.toUtf8().toPercentEncoding() + "%5D&br=320000";
+        const QByteArray request = head + "Content-Length: " + QByteArray::number(body.size()) +
+                                   "\r\n\r\n" + body;
+
+        QTcpSocket *socket = new QTcpSocket(this);
+        sockets << socket;
+        connect(socket, &QTcpSocket::connected, socket, [socket, request]
+                { socket->write(request); });
+        // The server answers once matching is done, the body is not needed
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]
+                { const QByteArray status = socket->peek(12);
+                  if (status.size() == 12)
+                      finish(socket, status.startsWith("HTTP/") && status.endsWith(" 200")); });
+        connect(socket, &QTcpSocket::errorOccurred, this, [this, socket]
+                { finish(socket, false); }, Qt::QueuedConnection);
+        QTimer::singleShot(LookupTimeout, socket, [this, socket]
+                           { finish(socket, false); });
+        socket->connectToHost(host, port);
+    }
+}
+
+void WarmUp::stop()
+{
+    for (QTcpSocket *socket : std::exchange(sockets, {}))
+    {
+        socket->disconnect();
+        socket->abort();
+        socket->deleteLater();
+    }
+    answered = 0;
+    total = 0;
+}
+
+void WarmUp::finish(QTcpSocket *socket, const bool &ok)
+{
+    if (!sockets.removeOne(socket))
+    {
+        return;
+    }
+    socket->disconnect();
+    socket->abort();
+    socket->deleteLater();
+    answered += ok;
+    if (sockets.isEmpty())
+    {
+        emit finished(timer.elapsed(), answered, total);
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "config/config.h"
+
+#include <QElapsedTimer>
+#include <QTcpSocket>
+
+// Looks up the configured songs through the local proxy once the server
+// is up, so that module loading, JIT, DNS and TLS to NetEase and the
+// sources happen before the first real request rather than on it.
+class WarmUp : public QObject
+{
+    Q_OBJECT
+
+public:
+    WarmUp(Config *config, QObject *parent);
+    ~WarmUp();
+
+    void start(const QString &host, const quint16 &port);
+    void stop();
+
+signals:
+    void finished(const qint64 &elapsed, const int &answered, const int &total);
+
+private:
+    Config *config;
+    QList<QTcpSocket *> sockets;
+    QElapsedTimer timer;
+    int answered;
+    int total;
+
+    void finish(QTcpSocket *socket, const bool &ok);
+};
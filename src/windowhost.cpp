@@ -0,0 +1,436 @@
+#include "windowhost.h"
+#include "metrics.h"
+#include "pacserver.h"
+#include "resourcemonitor.h"
+#include "trace.h"
+
+#include <QApplication>
+#include <QLocale>
+#include <QMessageBox>
+
+#ifdef Q_OS_WIN
+#include "utils/winutils.h"
+#include <Windows.h>
+#elif defined(Q_OS_LINUX)
+#include "utils/linuxutils.h"
+#endif
+
+using namespace Qt::StringLiterals;
+
+// Time for the deleted widgets to go before measuring memory again
+static constexpr int ReleaseSettle = 1000;
+
+WindowHost::WindowHost(Config *config, LogMetrics *logMetrics, SourceRanking *sourceRanking, LogStore *logStore)
+    : QObject(), config(config), logMetrics(logMetrics),
+      sourceRanking(sourceRanking), logStore(logStore), w(nullptr),
+      releaseTimer(new QTimer(this)), configWatcher(new QFileSystemWatcher(this)),
+      configTimer(new QTimer(this)), stallCount(0), longestStall(0),
+      hasUpdate(false), switching(false)
+{
+    releaseTimer->setSingleShot(true);
+    connect(releaseTimer, &QTimer::timeout, this, &WindowHost::release);
+
+    applySettings();
+
+    // Editors may write the file in several steps
+    configTimer->setSingleShot(true);
+    configTimer->setInterval(500);
+    connect(configWatcher, &QFileSystemWatcher::fileChanged, configTimer, qOverload<>(&QTimer::start));
+    connect(configTimer, &QTimer::timeout, this, &WindowHost::on_configChanged);
+    configWatcher->addPath(config->fileName());
+}
+
+WindowHost::~WindowHost()
+{
+    delete w;
+}
+
+MainWindow *WindowHost::window()
+{
+    if (w)
+    {
+        return w;
+    }
+    const TraceSpan span("WindowHost::window", "window");
+    w = new MainWindow(config, logMetrics, sourceRanking, logStore, this);
+    w->installEventFilter(this);
+    connect(w, &MainWindow::settingsChanged, this, &WindowHost::settingsChanged);
+    connect(w, &MainWindow::serverProfile, this, &WindowHost::serverProfile);
+    if (hasUpdate)
+    {
+        w->gotUpdateStatus(hasUpdate, updateVersion, updateUrl);
+    }
+    Metrics::windowBuilt.set(1);
+    return w;
+}
+
+bool WindowHost::isVisible() const
+{
+    return w && w->isVisible();
+}
+
+void WindowHost::show()
+{
+    MainWindow *window = this->window();
+#ifdef Q_OS_WIN
+    ShowWindow((HWND)window->winId(), SW_RESTORE);
+#endif
+    window->show();
+    window->activateWindow();
+}
+
+void WindowHost::toggle()
+{
+    if (isVisible())
+    {
+        w->close();
+    }
+    else
+    {
+        show();
+    }
+}
+
+void WindowHost::exit()
+{
+    qDebug("---Shutting down---");
+    emit serverClose();
+    // Unsaved edits only exist in a built window
+    w ? w->updateSettings() : config->writeSettings();
+    QApplication::exit();
+}
+
+bool WindowHost::eventFilter(QObject *object, QEvent *event)
+{
+    if (object == w)
+    {
+        switch (event->type())
+        {
+        case QEvent::Hide:
+            if (config->windowRelease > 0)
+            {
+                releaseTimer->start(config->windowRelease * 60 * 1000);
+            }
+            break;
+        case QEvent::Show:
+            releaseTimer->stop();
+            break;
+        default:
+            break;
+        }
+    }
+    return QObject::eventFilter(object, event);
+}
+
+// Destroy the hidden window, the log and status stay here
+void WindowHost::release()
+{
+    // Minimized windows are still visible
+    if (!w || w->isVisible())
+    {
+        return;
+    }
+    const qint64 before = ResourceMonitor::processStats(QCoreApplication::applicationPid()).rss;
+    w->removeEventFilter(this);
+    w->deleteLater();
+    w = nullptr;
+    Metrics::windowBuilt.set(0);
+
+    QTimer::singleShot(ReleaseSettle, this, [this, before]
+                       {
+#ifdef Q_OS_LINUX
+                           LinuxUtils::releaseMemory();
+#endif
+                           const qint64 after = ResourceMonitor::processStats(QCoreApplication::applicationPid()).rss;
+                           const QLocale locale;
+                           logStore->append(tr("Released the hidden window, memory %1 -> %2")
+                                                .arg(locale.formattedDataSize(before),
+                                                     locale.formattedDataSize(after))); });
+}
+
+bool WindowHost::setProxy(const bool &enable)
+{
+    const TraceSpan span("WindowHost::setProxy", "proxy");
+    const QString address = config->params[Param::Address].value<QString>();
+    const QString port = config->ports().split(u':')[0];
+    bool ok = false;
+#ifdef Q_OS_WIN
+    ok = config->pacProxy
+             ? WinUtils::setAutoProxy(enable, PacServer::url(config))
+             : WinUtils::setSystemProxy(enable, address + u':' + port);
+#endif
+    if (ok)
+    {
+        Metrics::systemProxy.set(enable);
+        emit proxyChanged(enable);
+    }
+    if (!ok)
+    {
+        emit proxyChanged(isProxy());
+
+        const QString title = tr("Error");
+        const QString text =
+            tr("Failed to set system proxy.\n"
+               "Please check the server port "
+               "and address, and try again.");
+
+        QMessageBox *errorDlg = new QMessageBox(w);
+        errorDlg->setAttribute(Qt::WA_DeleteOnClose);
+        errorDlg->setWindowTitle(title);
+        errorDlg->setText(text);
+        errorDlg->setIcon(QMessageBox::Warning);
+        errorDlg->open();
+    }
+    return ok;
+}
+
+bool WindowHost::isProxy()
+{
+    const QString address = config->params[Param::Address].value<QString>();
+    const QString port = config->ports().split(u':')[0];
+    bool isProxy = false;
+#ifdef Q_OS_WIN
+    isProxy = config->pacProxy
+                  ? WinUtils::isAutoProxy(PacServer::url(config))
+                  : WinUtils::isSystemProxy(address + u':' + port);
+#endif
+    Metrics::systemProxy.set(isProxy);
+    return isProxy;
+}
+
+void WindowHost::applySettings()
+{
+#ifdef Q_OS_WIN
+    WinUtils::setStartup(config->startup,
+                         config->startMinimized);
+#endif
+}
+
+void WindowHost::gotUpdateStatus(const bool &isNewVersion, const QString &version, const QString &openUrl)
+{
+    hasUpdate = isNewVersion;
+    updateVersion = version;
+    updateUrl = openUrl;
+    if (w)
+    {
+        w->gotUpdateStatus(isNewVersion, version, openUrl);
+    }
+}
+
+void WindowHost::on_serverErr(const QString &message)
+{
+    const QString title = tr("Server error");
+    const QString text =
+        tr("The UnblockNeteaseMusic server "
+           "ran into an error.\n"
+           "Please change the arguments or "
+           "check port usage and try again.");
+
+    QMessageBox *errorDlg = new QMessageBox();
+    errorDlg->setAttribute(Qt::WA_DeleteOnClose);
+    errorDlg->setWindowTitle(title);
+    errorDlg->setText(text);
+    errorDlg->setDetailedText(message);
+    errorDlg->setIcon(QMessageBox::Warning);
+#ifdef Q_OS_WIN
+    WinUtils::setWindowFrame(errorDlg->winId(), errorDlg->style());
+#endif
+    errorDlg->exec();
+}
+
+void WindowHost::on_proxyStats(const quint64 &lookups, const quint64 &hits, const quint64 &coalesced)
+{
+    if (w)
+    {
+        w->on_proxyStats(lookups, hits, coalesced);
+    }
+}
+
+void WindowHost::on_hedgeStats(const quint64 &fired, const quint64 &wins, const qint64 &savedMs)
+{
+    if (w)
+    {
+        w->on_hedgeStats(fired, wins, savedMs);
+    }
+}
+
+void WindowHost::on_clientStats(const QList<ClientStats> &stats)
+{
+    if (w)
+    {
+        w->on_clientStats(stats);
+    }
+}
+
+void WindowHost::on_probed(const qint64 &latency, const double &average, const qint64 &p95)
+{
+    if (w)
+    {
+        w->on_probed(latency, average, p95);
+    }
+}
+
+void WindowHost::on_sampled(const ResourceSample &sample, const ResourceSample &peak)
+{
+    if (w)
+    {
+        w->on_sampled(sample, peak);
+    }
+}
+
+void WindowHost::on_nodeSampled(const NodeSample &sample)
+{
+    if (w)
+    {
+        w->on_nodeSampled(sample);
+    }
+}
+
+void WindowHost::on_stalled(const qint64 &duration, const QStringList &backtrace)
+{
+    stallCount++;
+    longestStall = qMax(longestStall, duration);
+    logStore->append(tr("GUI stalled for %1 ms").arg(duration) + u'\n' + backtrace.join(u'\n'));
+    if (w)
+    {
+        w->on_stalled(duration, stallCount, longestStall, backtrace);
+    }
+}
+
+// The server moved to free ports, point the proxy and the UI there
+void WindowHost::on_portsChanged(const QString &ports)
+{
+    if (ports == config->activePorts)
+    {
+        return;
+    }
+    const bool wasProxy = isProxy();
+    config->activePorts = ports;
+    if (w)
+    {
+        w->on_portsChanged(config->ports());
+    }
+    if (wasProxy)
+    {
+        setProxy(true);
+    }
+}
+
+// The settings file was changed outside the app
+void WindowHost::on_configChanged()
+{
+    // Files replaced by a rename are no longer watched
+    if (!configWatcher->files().contains(config->fileName()))
+    {
+        configWatcher->addPath(config->fileName());
+    }
+    if (!config->refresh())
+    {
+        return;
+    }
+    qDebug("Settings file changed");
+    const bool wasProxy = isProxy();
+    config->readSettings();
+    reload(wasProxy);
+}
+
+void WindowHost::on_firstMatched(const qint64 &latency, const bool &warmedUp)
+{
+    logStore->append(warmedUp ? tr("First song matched in %1 ms, after a warm-up.").arg(latency)
+                              : tr("First song matched in %1 ms, without a warm-up.").arg(latency));
+}
+
+// Apply settings changed outside the window
+void WindowHost::reload(const bool &wasProxy)
+{
+    applySettings();
+    logMetrics->loadPatterns();
+    emit settingsChanged();
+    if (wasProxy)
+    {
+        // Strict mode only allows the auto-config proxy
+        setProxy(config->pacProxy || !config->params[Param::Strict].value<bool>());
+    }
+    if (w)
+    {
+        w->reloadSettings();
+    }
+}
+
+bool WindowHost::switchProfile(const QString &name)
+{
+    if (!config->profiles.contains(name))
+    {
+        return false;
+    }
+    if (name == config->profile)
+    {
+        return true;
+    }
+    const TraceSpan span("WindowHost::switchProfile", "profile");
+    // Forwarded to the standby before anything restarts
+    if (config->frontProxy && config->warmStandby && config->standbyProfile == name)
+    {
+        emit standbySwitch(Trace::now());
+    }
+    logStore->append(tr("Switching to profile %1.").arg(name));
+    const bool wasProxy = isProxy();
+    if (!switching)
+    {
+        previousProfile = config->profile;
+        switching = true;
+    }
+    config->applyProfile(name);
+    config->writeSettings();
+    reload(wasProxy);
+    return true;
+}
+
+void WindowHost::saveProfile(const QString &name)
+{
+    config->saveProfile(name);
+    config->writeSettings();
+    if (!switching)
+    {
+        warmNext();
+    }
+}
+
+void WindowHost::deleteProfile(const QString &name)
+{
+    config->profiles.remove(name);
+    if (config->profile == name)
+    {
+        config->profile.clear();
+    }
+    config->writeSettings();
+    if (!switching)
+    {
+        warmNext();
+    }
+}
+
+// The standby keeps its profile during a switch, as it may be serving
+// until the primary is ready. Then it moves to the profile left.
+void WindowHost::on_serverReady()
+{
+    const QString left = switching ? previousProfile : QString();
+    switching = false;
+    warmNext(left);
+}
+
+// Run the profile most likely to be switched to next in the standby,
+// saved and reloaded only when that changes
+void WindowHost::warmNext(const QString &preferred)
+{
+    const QString next = config->profiles.contains(preferred) && preferred != config->profile
+                             ? preferred
+                             : config->nextProfile();
+    if (next == config->standbyProfile)
+    {
+        return;
+    }
+    config->standbyProfile = next;
+    config->writeSettings();
+    emit standbyChanged();
+}
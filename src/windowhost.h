@@ -0,0 +1,81 @@
+#pragma once
+
+#include "config/config.h"
+#include "logmetrics.h"
+#include "logstore.h"
+#include "mainwindow.h"
+#include "sourceranking.h"
+
+#include <QFileSystemWatcher>
+#include <QTimer>
+
+// Owns what outlives the main window: the system proxy, the settings file
+// and the latest status. The window is built when first shown and
+// destroyed after staying hidden for a while.
+class WindowHost : public QObject
+{
+    Q_OBJECT
+
+public:
+    WindowHost(Config *config, LogMetrics *logMetrics, SourceRanking *sourceRanking, LogStore *logStore);
+    ~WindowHost();
+
+    MainWindow *window();
+    bool isVisible() const;
+    bool setProxy(const bool &enable);
+    bool isProxy();
+    void reload(const bool &wasProxy);
+    bool switchProfile(const QString &name);
+    void saveProfile(const QString &name);
+    void deleteProfile(const QString &name);
+
+public slots:
+    void show();
+    void toggle();
+    void exit();
+    void applySettings();
+    void gotUpdateStatus(const bool &isNewVersion, const QString &version, const QString &openUrl);
+    void on_serverErr(const QString &message);
+    void on_proxyStats(const quint64 &lookups, const quint64 &hits, const quint64 &coalesced);
+    void on_hedgeStats(const quint64 &fired, const quint64 &wins, const qint64 &savedMs);
+    void on_clientStats(const QList<ClientStats> &stats);
+    void on_probed(const qint64 &latency, const double &average, const qint64 &p95);
+    void on_sampled(const ResourceSample &sample, const ResourceSample &peak);
+    void on_nodeSampled(const NodeSample &sample);
+    void on_stalled(const qint64 &duration, const QStringList &backtrace);
+    void on_portsChanged(const QString &ports);
+    void on_serverReady();
+    void on_firstMatched(const qint64 &latency, const bool &warmedUp);
+
+signals:
+    void settingsChanged();
+    void serverClose();
+    void serverProfile(const Server::ProfileKind &kind, const int &seconds);
+    void proxyChanged(const bool &enabled);
+    void standbySwitch(const qint64 &requested);
+    void standbyChanged();
+
+protected:
+    bool eventFilter(QObject *object, QEvent *event) override;
+
+private:
+    Config *config;
+    LogMetrics *logMetrics;
+    SourceRanking *sourceRanking;
+    LogStore *logStore;
+    MainWindow *w;
+    QTimer *releaseTimer;
+    QFileSystemWatcher *configWatcher;
+    QTimer *configTimer;
+    int stallCount;
+    qint64 longestStall;
+    bool hasUpdate;
+    QString updateVersion;
+    QString updateUrl;
+    QString previousProfile;
+    bool switching;
+
+    void release();
+    void warmNext(const QString &preferred = QString());
+    void on_configChanged();
+};